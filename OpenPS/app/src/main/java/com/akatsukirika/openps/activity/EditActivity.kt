@@ -31,6 +31,7 @@ import com.akatsukirika.openps.interop.NativeLib
 import com.akatsukirika.openps.interop.PipelineDebugHelper
 import com.akatsukirika.openps.store.SettingsStore
 import com.akatsukirika.openps.utils.FrameRateObserver
+import com.akatsukirika.openps.utils.ToastUtils
 import com.akatsukirika.openps.viewmodel.CompositionViewModel
 import com.akatsukirika.openps.viewmodel.EditViewModel
 import com.akatsukirika.openps.viewmodel.EliminateViewModel
@@ -41,6 +42,7 @@ import kotlinx.coroutines.flow.combine
 import kotlinx.coroutines.flow.update
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
+import java.io.File
 
 class EditActivity : AppCompatActivity() {
     lateinit var binding: ActivityEditBinding
@@ -301,10 +303,17 @@ class EditActivity : AppCompatActivity() {
     private fun saveToGallery() {
         lifecycleScope.launch(Dispatchers.IO) {
             viewModel.updateLoadStatus(STATUS_LOADING)
-            ExportActivity.pixelsResult = viewModel.helper?.getResultPixels()
+            // 全分辨率结果按行带编码进缓存文件，不在内存中保留整张图
+            val file = File(cacheDir, EXPORT_FILE_NAME)
+            val success = viewModel.helper?.exportToFile(file.path) == true
             viewModel.updateLoadStatus(STATUS_SUCCESS)
             withContext(Dispatchers.Main) {
-                startExportForResult.launch(Intent(this@EditActivity, ExportActivity::class.java))
+                if (success) {
+                    ExportActivity.resultFile = file
+                    startExportForResult.launch(Intent(this@EditActivity, ExportActivity::class.java))
+                } else {
+                    ToastUtils.showToast(this@EditActivity, getString(R.string.msg_image_save_fail))
+                }
             }
         }
     }
@@ -353,6 +362,7 @@ class EditActivity : AppCompatActivity() {
     companion object {
         const val TAG = "EditActivity"
         private const val EXTRA_KEY_IMAGE_URI = "image_uri"
+        private const val EXPORT_FILE_NAME = "export.png"
 
         fun startMe(activity: Activity, imageUri: Uri) {
             val intent = Intent(activity, EditActivity::class.java).apply {
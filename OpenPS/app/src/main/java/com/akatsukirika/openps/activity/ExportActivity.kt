@@ -1,6 +1,5 @@
 package com.akatsukirika.openps.activity
 
-import android.graphics.Bitmap
 import android.os.Bundle
 import android.view.MenuItem
 import android.view.View
@@ -11,10 +10,11 @@ import com.akatsukirika.openps.databinding.ActivityExportBinding
 import com.akatsukirika.openps.utils.BitmapUtils
 import com.akatsukirika.openps.utils.BitmapUtils.scaleToMaxLongSide
 import com.akatsukirika.openps.utils.ToastUtils
-import com.pixpark.gpupixel.model.PixelsResult
 import kotlinx.coroutines.Dispatchers
 import kotlinx.coroutines.launch
 import kotlinx.coroutines.withContext
+import java.io.File
+import java.io.IOException
 
 class ExportActivity : AppCompatActivity() {
     private lateinit var binding: ActivityExportBinding
@@ -29,7 +29,7 @@ class ExportActivity : AppCompatActivity() {
             setTitle(R.string.image_save)
         }
 
-        pixelsResultToBitmap()
+        saveResultFile()
 
         binding.llBack.setOnClickListener {
             setResult(RESULT_OK)
@@ -50,40 +50,41 @@ class ExportActivity : AppCompatActivity() {
 
     override fun onDestroy() {
         super.onDestroy()
-        pixelsResult = null
+        resultFile = null
     }
 
-    private fun pixelsResultToBitmap() {
+    private fun saveResultFile() {
         lifecycleScope.launch(Dispatchers.IO) {
-            pixelsResult?.let {
-                val resultBitmap = Bitmap.createBitmap(it.width, it.height, Bitmap.Config.ARGB_8888)
-                val byteArray = it.data
-                val argbArray = IntArray(it.width * it.height)
-                for (i in 0 until it.width * it.height) {
-                    val r = byteArray[i * 4].toInt() and 0xFF
-                    val g = byteArray[i * 4 + 1].toInt() and 0xFF
-                    val b = byteArray[i * 4 + 2].toInt() and 0xFF
-                    val a = byteArray[i * 4 + 3].toInt() and 0xFF
-                    argbArray[i] = (a shl 24) or (r shl 16) or (g shl 8) or b
-                }
-                resultBitmap.setPixels(argbArray, 0, it.width, 0, 0, it.width, it.height)
+            resultFile?.let {
                 val fileName = generateFileName()
-                val uri = BitmapUtils.saveBitmapToGallery(this@ExportActivity, resultBitmap, fileName)
+                val uri = try {
+                    BitmapUtils.saveFileToGallery(this@ExportActivity, it, fileName, "image/png")
+                } catch (e: IOException) {
+                    e.printStackTrace()
+                    null
+                }
+                val previewBitmap = BitmapUtils.decodeSampledFile(it, MAX_SIZE)
+                it.delete()
                 withContext(Dispatchers.Main) {
                     if (uri == null) {
                         ToastUtils.showToast(this@ExportActivity, getString(R.string.msg_image_save_fail))
+                    } else {
+                        ToastUtils.showToast(this@ExportActivity, getString(R.string.msg_image_saved_png))
+                    }
+                    previewBitmap?.let { bitmap ->
+                        binding.resultImage.setImageBitmap(bitmap.scaleToMaxLongSide(MAX_SIZE))
                     }
-                    binding.resultImage.setImageBitmap(resultBitmap.scaleToMaxLongSide(MAX_SIZE))
                     binding.llBack.visibility = View.VISIBLE
                 }
             }
         }
     }
 
-    private fun generateFileName() = "OpenPS_${System.currentTimeMillis() / 1000}.jpg"
+    private fun generateFileName() = "OpenPS_${System.currentTimeMillis() / 1000}.png"
 
     companion object {
         private const val MAX_SIZE = 1024
-        var pixelsResult: PixelsResult? = null
+        // 由 EditActivity 导出的全分辨率 PNG，保存进相册后删除
+        var resultFile: File? = null
     }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@ package com.akatsukirika.openps.utils
 import android.content.ContentValues
 import android.content.Context
 import android.graphics.Bitmap
+import android.graphics.BitmapFactory
 import android.graphics.Canvas
 import android.graphics.Color
 import android.graphics.Matrix
@@ -73,6 +74,58 @@ object BitmapUtils {
         return imageUri
     }
 
+    /**
+     * 把已编码好的图片文件原样拷贝进相册，不经过 Bitmap
+     */
+    fun saveFileToGallery(context: Context, file: File, filename: String, mimeType: String): Uri? {
+        val contentResolver = context.contentResolver
+
+        val imageCollection = if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+            MediaStore.Images.Media.getContentUri(MediaStore.VOLUME_EXTERNAL_PRIMARY)
+        } else {
+            MediaStore.Images.Media.EXTERNAL_CONTENT_URI
+        }
+
+        val contentValues = ContentValues().apply {
+            put(MediaStore.Images.Media.DISPLAY_NAME, filename)
+            put(MediaStore.Images.Media.MIME_TYPE, mimeType)
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                put(MediaStore.Images.Media.IS_PENDING, 1)
+            }
+        }
+
+        val imageUri = contentResolver.insert(imageCollection, contentValues)
+
+        imageUri?.let { uri ->
+            contentResolver.openOutputStream(uri)?.use { outputStream ->
+                file.inputStream().use { it.copyTo(outputStream) }
+            } ?: throw IOException("Failed to open output stream.")
+
+            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.Q) {
+                contentValues.clear()
+                contentValues.put(MediaStore.Images.Media.IS_PENDING, 0)
+                contentResolver.update(uri, contentValues, null, null)
+            }
+        }
+
+        return imageUri
+    }
+
+    /**
+     * 按 2 的幂次降采样解码，长边不小于 maxSize
+     */
+    fun decodeSampledFile(file: File, maxSize: Int): Bitmap? {
+        val options = BitmapFactory.Options().apply { inJustDecodeBounds = true }
+        BitmapFactory.decodeFile(file.path, options)
+        var sampleSize = 1
+        while (maxOf(options.outWidth, options.outHeight) / (sampleSize * 2) >= maxSize) {
+            sampleSize *= 2
+        }
+        options.inJustDecodeBounds = false
+        options.inSampleSize = sampleSize
+        return BitmapFactory.decodeFile(file.path, options)
+    }
+
     fun cropBitmap(bitmap: Bitmap, left: Float, top: Float, right: Float, bottom: Float): Bitmap {
         if (left < 0f || top < 0f || right > 1f || bottom > 1f || left >= right || top >= bottom) {
             throw IllegalArgumentException("Invalid crop parameters")
@@ -387,7 +387,7 @@ class EditViewModel : ViewModel() {
             // 1. 从Native层获取VNN人脸识别的结果
             val landmarkResult = helper?.getLandmark()
             val rect = landmarkResult?.rect
-            if (rect != null && rect.size == 4) {
+            if (rect != null && rect.size >= 4) {
                 val rectLeft = rect[0]
                 val rectTop = rect[1]
                 val rectRight = rect[2]
@@ -481,7 +481,7 @@ class EditViewModel : ViewModel() {
             // 1. 从Native层获取VNN人脸识别的结果
             val landmarkResult = helper?.getManualDetectFaceLandmark()
             val rect = landmarkResult?.rect
-            if (rect != null && rect.size == 4) {
+            if (rect != null && rect.size >= 4) {
                 val rectLeft = rect[0]
                 val rectTop = rect[1]
                 val rectRight = rect[2]
@@ -2,15 +2,39 @@
 
 #include "gpupixel_context.h"
 #include "openps_helper.h"
+#include "jni_helpers.h"
 #include <android/bitmap.h>
 
 USING_NS_GPUPIXEL
 
 std::unique_ptr<OpenPSHelper> openPSHelper;
+jobject globalTaskScheduler = nullptr;
 
 extern "C" JNIEXPORT void JNICALL
-Java_com_pixpark_gpupixel_OpenPS_nativeInit(JNIEnv *env, jobject thiz) {
+Java_com_pixpark_gpupixel_OpenPS_nativeInit(JNIEnv *env, jobject thiz, jobject taskScheduler) {
   openPSHelper = std::make_unique<OpenPSHelper>();
+  jobject previousScheduler = globalTaskScheduler;
+  globalTaskScheduler = env->NewGlobalRef(taskScheduler);
+  // Tasks may be queued from any thread, which has to attach itself
+  jobject scheduler = globalTaskScheduler;
+  GPUPixelContext::getInstance()->setTaskScheduler([scheduler]() {
+    AttachThreadScoped scope(GetJVM());
+    JNIEnv* threadEnv = scope.env();
+    jclass schedulerClass = threadEnv->GetObjectClass(scheduler);
+    jmethodID methodId = threadEnv->GetMethodID(schedulerClass, "run", "()V");
+    threadEnv->CallVoidMethod(scheduler, methodId);
+    threadEnv->DeleteLocalRef(schedulerClass);
+  });
+  if (previousScheduler != nullptr) {
+    env->DeleteGlobalRef(previousScheduler);
+  }
+}
+
+extern "C" JNIEXPORT void JNICALL
+Java_com_pixpark_gpupixel_OpenPS_nativeProcessTasks(JNIEnv *env, jobject thiz) {
+  if (openPSHelper) {
+    GPUPixelContext::getInstance()->processTasks();
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -81,6 +105,10 @@ Java_com_pixpark_gpupixel_OpenPS_nativeChangeImage(JNIEnv *env, jobject thiz,
 extern "C" JNIEXPORT void JNICALL
 Java_com_pixpark_gpupixel_OpenPS_nativeDestroy(JNIEnv *env, jobject thiz) {
   openPSHelper.reset();
+  if (globalTaskScheduler != nullptr) {
+    env->DeleteGlobalRef(globalTaskScheduler);
+    globalTaskScheduler = nullptr;
+  }
 }
 
 extern "C" JNIEXPORT void JNICALL
@@ -188,6 +216,23 @@ Java_com_pixpark_gpupixel_OpenPS_nativeSetRawOutputCallback(JNIEnv *env, jobject
   }
 }
 
+extern "C" JNIEXPORT void JNICALL
+Java_com_pixpark_gpupixel_OpenPS_nativeExportToFile(JNIEnv *env, jobject thiz, jstring path, jobject receiver) {
+  if (openPSHelper) {
+    jobject globalReceiver = env->NewGlobalRef(receiver);
+    // The result arrives on the encoder thread, which has to attach itself
+    openPSHelper->exportToFile(JavaToStdString(env, path), [globalReceiver](bool success) {
+      AttachThreadScoped scope(GetJVM());
+      JNIEnv* threadEnv = scope.env();
+      jclass receiverClass = threadEnv->GetObjectClass(globalReceiver);
+      jmethodID methodId = threadEnv->GetMethodID(receiverClass, "onExportFinished", "(Z)V");
+      threadEnv->CallVoidMethod(globalReceiver, methodId, (jboolean) success);
+      threadEnv->DeleteLocalRef(receiverClass);
+      threadEnv->DeleteGlobalRef(globalReceiver);
+    });
+  }
+}
+
 extern "C" JNIEXPORT void JNICALL
 Java_com_pixpark_gpupixel_OpenPS_nativeSetSmoothLevel(JNIEnv *env, jobject thiz, jfloat level, jboolean addRecord) {
   if (openPSHelper) {
@@ -8,6 +8,7 @@
 #include "framebuffer.h"
 #include <assert.h>
 #include <algorithm>
+#include <cstring>
 #include "gpupixel_context.h"
 #include "util.h"
 
@@ -65,6 +66,7 @@ Framebuffer::~Framebuffer() {
 void Framebuffer::active() {
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
   CHECK_GL(glViewport(0, 0, _width, _height));
+  _mipmapsDirty = true;
 }
 
 void Framebuffer::inactive() {
@@ -83,10 +85,104 @@ void Framebuffer::_generateTexture() {
   CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
                            _textureAttributes.wrapT));
 
-  // TODO: Handle mipmaps
+  // Mip levels are only built on demand by generateMipmaps(), the min filter
+  // stays as configured so filters keep sampling level 0
   CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
+bool Framebuffer::generateMipmaps() {
+  if (!isMipmapSupported()) {
+    return false;
+  }
+  // Texture only framebuffers are uploaded outside of active(), so always
+  // rebuild their chain
+  if (_hasFB && !_mipmapsDirty) {
+    return true;
+  }
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D, _texture));
+  CHECK_GL(glGenerateMipmap(GL_TEXTURE_2D));
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+  _mipmapsDirty = false;
+  return true;
+}
+
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
+static bool isGLES3() {
+  static int es3 = -1;
+  if (es3 < 0) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    es3 = version && strstr(version, "OpenGL ES 3");
+  }
+  return es3;
+}
+
+static bool hasGLExtension(const char* name) {
+  const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+  return extensions && strstr(extensions, name);
+}
+#endif
+
+bool Framebuffer::isMipmapSupported() {
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
+  // ES 2.0 can only mipmap power of two textures without GL_OES_texture_npot
+  static int supported = -1;
+  if (supported < 0) {
+    supported = isGLES3() || hasGLExtension("GL_OES_texture_npot");
+  }
+  return supported;
+#else
+  return true;
+#endif
+}
+
+int Framebuffer::getMaxTextureSize() {
+  static GLint maxTextureSize = 0;
+  if (maxTextureSize <= 0) {
+    CHECK_GL(glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize));
+  }
+  return maxTextureSize;
+}
+
+TextureAttributes Framebuffer::singleChannelTextureAttributes() {
+  TextureAttributes attributes = defaultTextureAttribures;
+  // GL_LUMINANCE is not color renderable, render targets need the red format
+  // of ES 3 / GL_EXT_texture_rg. Samplers read it back as (r, 0, 0, 1).
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
+  static int support = -1;
+  if (support < 0) {
+    support = isGLES3() ? 2 : hasGLExtension("GL_EXT_texture_rg") ? 1 : 0;
+  }
+  if (support > 0) {
+    attributes.internalFormat = support == 2 ? GL_R8 : GL_RED;
+    attributes.format = GL_RED;
+  }
+#elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+  attributes.internalFormat = GL_R8;
+  attributes.format = GL_RED;
+#endif
+  return attributes;
+}
+
+TextureAttributes Framebuffer::halfFloatTextureAttributes() {
+  TextureAttributes attributes = defaultTextureAttribures;
+#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
+  // RGBA16F is filterable in ES 3 but only renderable with an extension
+  static int supported = -1;
+  if (supported < 0) {
+    supported = isGLES3() && (hasGLExtension("GL_EXT_color_buffer_half_float") ||
+                              hasGLExtension("GL_EXT_color_buffer_float"));
+  }
+  if (supported) {
+    attributes.internalFormat = GL_RGBA16F;
+    attributes.type = GL_HALF_FLOAT;
+  }
+#elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+  attributes.internalFormat = GL_RGBA16F;
+  attributes.type = GL_HALF_FLOAT;
+#endif
+  return attributes;
+}
+
 void Framebuffer::_generateFramebuffer() {
   CHECK_GL(glGenFramebuffers(1, &_framebuffer));
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, _framebuffer));
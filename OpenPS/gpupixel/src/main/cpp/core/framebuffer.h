@@ -22,6 +22,17 @@ GPUPIXEL_API typedef struct {
   GLenum type;
 } TextureAttributes;
 
+inline bool operator==(const TextureAttributes& a, const TextureAttributes& b) {
+  return a.minFilter == b.minFilter && a.magFilter == b.magFilter &&
+         a.wrapS == b.wrapS && a.wrapT == b.wrapT &&
+         a.internalFormat == b.internalFormat && a.format == b.format &&
+         a.type == b.type;
+}
+
+inline bool operator!=(const TextureAttributes& a, const TextureAttributes& b) {
+  return !(a == b);
+}
+
 class GPUPIXEL_API Framebuffer {
  public:
   Framebuffer(
@@ -45,6 +56,19 @@ class GPUPIXEL_API Framebuffer {
   void active();
   void inactive();
 
+  // Regenerates the mip chain if level 0 was rendered since the last call.
+  // Returns false if the current context can't mipmap this texture.
+  bool generateMipmaps();
+  static bool isMipmapSupported();
+  static int getMaxTextureSize();
+
+  // Render target formats for single channel content such as masks and
+  // grayscale intermediates, and for intermediates that need more than 8 bits
+  // per channel. Both return defaultTextureAttribures where the context can't
+  // render to the format.
+  static TextureAttributes singleChannelTextureAttributes();
+  static TextureAttributes halfFloatTextureAttributes();
+
   static TextureAttributes defaultTextureAttribures;
 
  private:
@@ -53,6 +77,7 @@ class GPUPIXEL_API Framebuffer {
   bool _hasFB;
   GLuint _texture;
   GLuint _framebuffer;
+  bool _mipmapsDirty = true;
 
   void _generateTexture();
   void _generateFramebuffer();
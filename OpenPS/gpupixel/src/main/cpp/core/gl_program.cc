@@ -117,19 +117,59 @@ bool GLProgram::_initWithShaderString(const std::string& vertexShaderSource,
   CHECK_GL(glDeleteShader(vertShader));
   CHECK_GL(glDeleteShader(fragShader));
 
+  _cacheLocations();
   return true;
 }
 
+void GLProgram::_cacheLocations() {
+  _attribLocations.clear();
+  _uniformLocations.clear();
+  GLint count = 0;
+  GLint size;
+  GLenum type;
+  GLchar name[256];
+  CHECK_GL(glGetProgramiv(_program, GL_ACTIVE_ATTRIBUTES, &count));
+  for (GLint i = 0; i < count; i++) {
+    glGetActiveAttrib(_program, i, sizeof(name), nullptr, &size, &type, name);
+    _attribLocations[name] = glGetAttribLocation(_program, name);
+  }
+  CHECK_GL(glGetProgramiv(_program, GL_ACTIVE_UNIFORMS, &count));
+  for (GLint i = 0; i < count; i++) {
+    glGetActiveUniform(_program, i, sizeof(name), nullptr, &size, &type, name);
+    GLint location = glGetUniformLocation(_program, name);
+    _uniformLocations[name] = location;
+    // Arrays are reported as "name[0]", they are set by the bare name
+    std::string uniformName = name;
+    size_t bracket = uniformName.find('[');
+    if (bracket != std::string::npos) {
+      _uniformLocations[uniformName.substr(0, bracket)] = location;
+    }
+  }
+}
+
 void GLProgram::use() {
   CHECK_GL(glUseProgram(_program));
 }
 
 GLuint GLProgram::getAttribLocation(const std::string& attribute) {
-  return glGetAttribLocation(_program, attribute.c_str());
+  auto it = _attribLocations.find(attribute);
+  if (it != _attribLocations.end()) {
+    return it->second;
+  }
+  // Inactive names are remembered as -1 too
+  GLint location = glGetAttribLocation(_program, attribute.c_str());
+  _attribLocations[attribute] = location;
+  return location;
 }
 
 GLuint GLProgram::getUniformLocation(const std::string& uniformName) {
-  return glGetUniformLocation(_program, uniformName.c_str());
+  auto it = _uniformLocations.find(uniformName);
+  if (it != _uniformLocations.end()) {
+    return it->second;
+  }
+  GLint location = glGetUniformLocation(_program, uniformName.c_str());
+  _uniformLocations[uniformName] = location;
+  return location;
 }
 
 void GLProgram::setUniformValue(const std::string& uniformName, int value) {
@@ -169,6 +209,13 @@ void GLProgram::setUniformValue(const std::string& uniformName,
   setUniformValue(getUniformLocation(uniformName), value, length);
 }
 
+void GLProgram::setUniformValue(const std::string& uniformName,
+                                const Vector4* value,
+                                int count) {
+  GPUPixelContext::getInstance()->setActiveShaderProgram(this);
+  setUniformValue(getUniformLocation(uniformName), value, count);
+}
+
 void GLProgram::setUniformValue(int uniformLocation, int value) {
   GPUPixelContext::getInstance()->setActiveShaderProgram(this);
   CHECK_GL(glUniform1i(uniformLocation, value));
@@ -206,4 +253,11 @@ void GLProgram::setUniformValue(int uniformLocation,
   CHECK_GL(glUniform1fv(uniformLocation, length, (GLfloat*)value));
 }
 
+void GLProgram::setUniformValue(int uniformLocation,
+                                const Vector4* value,
+                                int count) {
+  GPUPixelContext::getInstance()->setActiveShaderProgram(this);
+  CHECK_GL(glUniform4fv(uniformLocation, count, (GLfloat*)value));
+}
+
 NS_GPUPIXEL_END
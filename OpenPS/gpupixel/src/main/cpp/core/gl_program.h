@@ -10,6 +10,7 @@
 #include "gpupixel_macros.h"
 
 #include "math_toolbox.h"
+#include <unordered_map>
 #include <vector>
 #include <string>
 
@@ -25,6 +26,7 @@ class GPUPIXEL_API GLProgram {
   void use();
   GLuint getID() const { return _program; }
 
+  // Locations are read once when the program links and cached by name
   GLuint getAttribLocation(const std::string& attribute);
   GLuint getUniformLocation(const std::string& uniformName);
 
@@ -38,6 +40,10 @@ class GPUPIXEL_API GLProgram {
   void setUniformValue(const std::string& uniformName,
                        const void* array,
                        int length);
+  // vec4 uniform array
+  void setUniformValue(const std::string& uniformName,
+                       const Vector4* array,
+                       int count);
 
   void setUniformValue(int uniformLocation, int value);
   void setUniformValue(int uniformLocation, float value);
@@ -46,12 +52,16 @@ class GPUPIXEL_API GLProgram {
   void setUniformValue(int uniformLocation, Matrix3 value);
   void setUniformValue(int uniformLocation, Matrix4 value);
   void setUniformValue(int uniformLocation, const void* array, int length);
+  void setUniformValue(int uniformLocation, const Vector4* array, int count);
 
  private:
   static std::vector<GLProgram*> _programs;
   GLuint _program;
+  std::unordered_map<std::string, GLint> _attribLocations;
+  std::unordered_map<std::string, GLint> _uniformLocations;
   bool _initWithShaderString(const std::string& vertexShaderSource,
                              const std::string& fragmentShaderSource);
+  void _cacheLocations();
 };
 
 NS_GPUPIXEL_END
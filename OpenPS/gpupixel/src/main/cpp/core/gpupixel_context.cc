@@ -6,7 +6,12 @@
  */
 
 #include "gpupixel_context.h"
+#include <cassert>
+#include <future>
 #include "util.h"
+#if defined(GPUPIXEL_ANDROID)
+#include <unistd.h>
+#endif
 
 #if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
 
@@ -77,6 +82,11 @@ NS_GPUPIXEL_BEGIN
 iOSHelper* iosHelper;
 #elif defined(GPUPIXEL_ANDROID)
 const std::string kRtcLogTag = "Context";
+
+// The main thread of an Android process has the process id as thread id
+static bool isUiThread() {
+  return gettid() == getpid();
+}
 #elif defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
 const unsigned int VIEW_WIDTH = 1280;
 const unsigned int VIEW_HEIGHT = 720;
@@ -93,6 +103,7 @@ GPUPixelContext::GPUPixelContext()
       capturedFrameData(0) {
   _framebufferCache = new FramebufferCache();
   task_queue_ = std::make_shared<LocalDispatchQueue>();
+  gl_thread_ = std::this_thread::get_id();
   init();
 }
 
@@ -129,12 +140,53 @@ FramebufferCache* GPUPixelContext::getFramebufferCache() const {
   return _framebufferCache;
 }
 
+namespace {
+const GLfloat kQuadPositions[] = {
+    -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
+};
+const int kRotationModeCount = Rotate180 + 1;
+}  // namespace
+
+void GPUPixelContext::bindQuadBuffer() {
+  if (_quadBuffer) {
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _quadBuffer));
+    return;
+  }
+  // Freed with the GL context
+  std::vector<GLfloat> vertices(kQuadPositions, kQuadPositions + 8);
+  for (int mode = 0; mode < kRotationModeCount; mode++) {
+    const GLfloat* coordinates = Filter::getTextureCoordinates((RotationMode)mode);
+    vertices.insert(vertices.end(), coordinates, coordinates + 8);
+  }
+  CHECK_GL(glGenBuffers(1, &_quadBuffer));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _quadBuffer));
+  CHECK_GL(glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+                        vertices.data(), GL_STATIC_DRAW));
+}
+
+void GPUPixelContext::setQuadPositionAttribute(GLuint attribute) {
+  bindQuadBuffer();
+  CHECK_GL(glVertexAttribPointer(attribute, 2, GL_FLOAT, 0, 0, 0));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
+void GPUPixelContext::setQuadTexCoordAttribute(GLuint attribute,
+                                               RotationMode rotationMode) {
+  bindQuadBuffer();
+  size_t offset = sizeof(kQuadPositions) * (1 + (int)rotationMode);
+  CHECK_GL(glVertexAttribPointer(attribute, 2, GL_FLOAT, 0, 0,
+                                 (const GLvoid*)offset));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
+
 void GPUPixelContext::setActiveShaderProgram(GLProgram* shaderProgram) {
   if (_curShaderProgram != shaderProgram) {
     _curShaderProgram = shaderProgram;
+#if defined(GPUPIXEL_ANDROID)
     if (shaderProgram) {
       Util::onActivateProgram(shaderProgram->getID());
     }
+#endif
     shaderProgram->use();
   }
 }
@@ -341,17 +393,77 @@ void GPUPixelContext::releaseContext() {
 }
  
 void GPUPixelContext::runSync(std::function<void(void)> func) {
-  // todo fix android 
 #if defined(GPUPIXEL_ANDROID)
-  func();
+  // The GL context belongs to the view's render thread and is never made
+  // current anywhere else
+  if (std::this_thread::get_id() == gl_thread_) {
+    func();
+    return;
+  }
+  if (isUiThread()) {
+    // GLSurfaceView blocks its render thread on the UI thread while it
+    // pauses or loses its surface, waiting for the render thread here can
+    // deadlock
+    Util::Log("ERROR", "runSync on the UI thread, queued without waiting");
+    assert(!"runSync must not be called on the UI thread");
+    runAsync(func);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(scheduler_mutex_);
+    if (!task_scheduler_) {
+      Util::Log("ERROR", "runSync off the GL thread without a task scheduler");
+      func();
+      return;
+    }
+  }
+  auto done = std::make_shared<std::promise<void>>();
+  std::future<void> finished = done->get_future();
+  task_queue_->add([=] {
+    func();
+    done->set_value();
+  });
+  scheduleTasks();
+  finished.wait();
+#else
+  task_queue_->add([=]() {
+      useAsCurrent();
+      func();
+  });
+  task_queue_->processAll();
+#endif
+}
+
+void GPUPixelContext::runAsync(std::function<void(void)> func) {
+#if defined(GPUPIXEL_ANDROID)
+  task_queue_->add(func);
+  scheduleTasks();
 #else
   task_queue_->add([=]() {
       useAsCurrent();
       func();
   });
-  task_queue_->processOne();
 #endif
+}
+
+void GPUPixelContext::processTasks() {
+  task_queue_->processAll();
+}
+
+void GPUPixelContext::setTaskScheduler(std::function<void(void)> scheduler) {
+  std::lock_guard<std::mutex> lock(scheduler_mutex_);
+  task_scheduler_ = scheduler;
+}
 
+void GPUPixelContext::scheduleTasks() {
+  std::function<void(void)> scheduler;
+  {
+    std::lock_guard<std::mutex> lock(scheduler_mutex_);
+    scheduler = task_scheduler_;
+  }
+  if (scheduler) {
+    scheduler();
+  }
 }
 
 NS_GPUPIXEL_END
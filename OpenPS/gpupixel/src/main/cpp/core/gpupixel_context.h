@@ -8,6 +8,7 @@
 #pragma once
 
 #include <mutex>
+#include <thread>
 #include "framebuffer_cache.h"
 #include "gpupixel_macros.h"
 #include "dispatch_queue.h"
@@ -35,8 +36,27 @@ class GPUPIXEL_API GPUPixelContext {
   void setActiveShaderProgram(GLProgram* shaderProgram);
   void purge();
 
+  // Full frame quads draw from one static vertex buffer as a 4 vertex
+  // GL_TRIANGLE_STRIP. These point an attribute at the clip space positions,
+  // or at the texture coordinates for a rotation. GL_ARRAY_BUFFER is unbound
+  // again afterwards.
+  void setQuadPositionAttribute(GLuint attribute);
+  void setQuadTexCoordAttribute(GLuint attribute, RotationMode rotationMode);
+
+  // Runs func on the GL thread and waits for it. On Android that is the thread
+  // the context was created on, calls from other threads are queued for it.
+  // Android callers may be the GL thread, where func runs inline, or worker
+  // threads. Never the UI thread, which the GL thread itself waits on: there
+  // debug builds assert, release builds queue func like runAsync and return
+  // before it has run.
   void runSync(std::function<void(void)> func);
+  // Queues func for the GL thread and returns right away
   void runAsync(std::function<void(void)> func);
+  // Runs the queued tasks, on the GL thread only
+  void processTasks();
+  // Called whenever a task is queued. It has to make the GL thread call
+  // processTasks() soon, e.g. by posting to the view's render thread.
+  void setTaskScheduler(std::function<void(void)> scheduler);
   void useAsCurrent(void);
   void presentBufferForDisplay();
  
@@ -64,12 +84,19 @@ class GPUPIXEL_API GPUPixelContext {
 
   void createContext();
   void releaseContext();
+  void bindQuadBuffer();
+  void scheduleTasks();
  private:
   static GPUPixelContext* _instance;
   static std::mutex _mutex;
   FramebufferCache* _framebufferCache;
   GLProgram* _curShaderProgram;
+  // positions, then texture coordinates for every RotationMode
+  GLuint _quadBuffer = 0;
   std::shared_ptr<LocalDispatchQueue> task_queue_;
+  std::thread::id gl_thread_;
+  std::mutex scheduler_mutex_;
+  std::function<void(void)> task_scheduler_;
   
 #if defined(GPUPIXEL_ANDROID)
   bool context_inited = false;
@@ -7,9 +7,13 @@
 
 #include "face_detector.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "vnn_kit.h"
 #include "vnn_face.h"
 
+#include "libyuv.h"
 #include "util.h"
 NS_GPUPIXEL_BEGIN
 
@@ -31,6 +35,17 @@ FaceDetector::FaceDetector() {
 }
 
 FaceDetector::~FaceDetector() {
+  if (worker_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(worker_mutex_);
+      worker_stop_ = true;
+    }
+    worker_cv_.notify_one();
+    worker_.join();
+  }
+  delete mailbox_.exchange(nullptr);
+  delete spare_.exchange(nullptr);
+
   if(vnn_handle_ > 0)
     VNN_Destroy_Face(&vnn_handle_);
 }
@@ -45,9 +60,276 @@ int FaceDetector::Detect(const uint8_t* data,
                     int height,
                     GPUPIXEL_MODE_FMT fmt,
                     GPUPIXEL_FRAME_TYPE type) {
+  std::vector<float> landmarks;
+  std::vector<float> rect;
+  int ret = DetectLandmarks(data, width, height, fmt, type, landmarks, rect);
+  if (ret != 0) {
+    return ret;
+  }
+  AppendDerivedPoints(landmarks);
+
+  // do callbck
+  for(auto cb : _face_detector_callbacks) {
+    cb(landmarks, rect);
+  }
+  return 0;
+}
+
+void FaceDetector::SetDetectionInterval(int frames) {
+  detection_interval_ = std::max(1, frames);
+}
+
+void FaceDetector::SetSmoothing(float minCutoff, float beta) {
+  smoothing_min_cutoff_ = minCutoff;
+  smoothing_beta_ = beta;
+}
+
+void FaceDetector::GetDetectionSize(int width, int height, int& outWidth, int& outHeight) const {
+  outWidth = width;
+  outHeight = height;
+  int longSide = std::max(width, height);
+  if (longSide > kMaxDetectionSize) {
+    // Even sizes keep the I420 chroma planes exact
+    outWidth = std::max(2, (int)((int64_t)width * kMaxDetectionSize / longSide) & ~1);
+    outHeight = std::max(2, (int)((int64_t)height * kMaxDetectionSize / longSide) & ~1);
+  }
+}
+
+void FaceDetector::DetectAsync(const uint8_t* rgba, int width, int height, int stride,
+                               int64_t ts) {
+  DetectionFrame* frame = AcquireFrame();
+  GetDetectionSize(width, height, frame->width, frame->height);
+  frame->type = GPUPIXEL_FRAME_TYPE_RGBA8888;
+  frame->ts = ts;
+  frame->data.resize((size_t)frame->width * frame->height * 4);
+  // Landmarks are normalized, so they apply to the full frame as they are
+  libyuv::ARGBScale(rgba, stride, width, height,
+                    frame->data.data(), frame->width * 4, frame->width, frame->height,
+                    libyuv::kFilterBilinear);
+  PostFrame(frame);
+}
+
+void FaceDetector::DetectAsync(int width, int height,
+                               const uint8_t* dataY, int strideY,
+                               const uint8_t* dataU, int strideU,
+                               const uint8_t* dataV, int strideV,
+                               int64_t ts) {
+  DetectionFrame* frame = AcquireFrame();
+  GetDetectionSize(width, height, frame->width, frame->height);
+  frame->type = GPUPIXEL_FRAME_TYPE_YUVI420;
+  frame->ts = ts;
+  int ySize = frame->width * frame->height;
+  int uvWidth = frame->width / 2;
+  int uvSize = uvWidth * (frame->height / 2);
+  frame->data.resize((size_t)ySize + uvSize * 2);
+  uint8_t* y = frame->data.data();
+  libyuv::I420Scale(dataY, strideY, dataU, strideU, dataV, strideV, width, height,
+                    y, frame->width, y + ySize, uvWidth, y + ySize + uvSize, uvWidth,
+                    frame->width, frame->height, libyuv::kFilterBilinear);
+  PostFrame(frame);
+}
+
+FaceDetector::DetectionFrame* FaceDetector::AcquireFrame() {
+  DetectionFrame* frame = spare_.exchange(nullptr);
+  return frame ? frame : new DetectionFrame();
+}
+
+void FaceDetector::PostFrame(DetectionFrame* frame) {
+  // An older frame still in the mailbox is dropped in favor of this one
+  DetectionFrame* dropped = mailbox_.exchange(frame);
+  if (dropped) {
+    delete spare_.exchange(dropped);
+  }
+
+  std::lock_guard<std::mutex> lock(worker_mutex_);
+  if (!worker_.joinable()) {
+    worker_ = std::thread(&FaceDetector::WorkerLoop, this);
+  }
+  worker_cv_.notify_one();
+}
+
+void FaceDetector::WorkerLoop() {
+  std::vector<float> landmarks;
+  std::vector<float> rect;
+  for (;;) {
+    DetectionFrame* frame = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(worker_mutex_);
+      worker_cv_.wait(lock, [&] {
+        return worker_stop_ || mailbox_.load() != nullptr;
+      });
+      if (worker_stop_) {
+        return;
+      }
+      frame = mailbox_.exchange(nullptr);
+    }
+    if (!frame) {
+      continue;
+    }
+
+    landmarks.clear();
+    rect.clear();
+    if (ProcessVideoFrame(*frame, landmarks, rect)) {
+      std::lock_guard<std::mutex> lock(result_mutex_);
+      result_landmarks_.swap(landmarks);
+      result_rect_.swap(rect);
+      result_ts_ = frame->ts;
+      result_pending_ = true;
+    }
+    delete spare_.exchange(frame);
+  }
+}
+
+bool FaceDetector::ProcessVideoFrame(const DetectionFrame& frame,
+                                     std::vector<float>& landmarks,
+                                     std::vector<float>& rect) {
+  const uint8_t* gray = frame.data.data();
+  if (frame.type == GPUPIXEL_FRAME_TYPE_RGBA8888) {
+    gray_.resize((size_t)frame.width * frame.height);
+    // RGBA bytes are libyuv's ABGR
+    libyuv::ABGRToJ400(frame.data.data(), frame.width * 4, gray_.data(), frame.width,
+                       frame.width, frame.height);
+    gray = gray_.data();
+  }
+
+  bool detect = detection_interval_ <= 1 || !tracker_.isTracking() ||
+                frames_since_detection_ >= detection_interval_;
+  if (!detect) {
+    if (tracker_.track(gray, frame.width, frame.height, landmarks) >= kMinTrackingConfidence) {
+      ++frames_since_detection_;
+      // Move each detected face box along with its landmarks
+      std::vector<float> centers = GetFaceCenters(landmarks);
+      rect = tracked_rect_;
+      for (size_t face = 0; face * 4 + 3 < rect.size() && face * 2 + 1 < centers.size(); face++) {
+        float dx = centers[face * 2] - tracked_centers_[face * 2];
+        float dy = centers[face * 2 + 1] - tracked_centers_[face * 2 + 1];
+        rect[face * 4] += dx;
+        rect[face * 4 + 1] += dy;
+        rect[face * 4 + 2] += dx;
+        rect[face * 4 + 3] += dy;
+      }
+    } else {
+      landmarks.clear();
+      detect = true;
+    }
+  }
+
+  if (detect) {
+    if (DetectLandmarks(frame.data.data(), frame.width, frame.height,
+                        GPUPIXEL_MODE_FMT_VIDEO, frame.type, landmarks, rect) != 0) {
+      return false;
+    }
+    frames_since_detection_ = 1;
+    if (landmarks.empty()) {
+      tracker_.clear();
+      smoother_.clear();
+      tracked_centers_.clear();
+      return true;
+    }
+    MatchFaceOrder(landmarks, rect);
+    tracker_.reset(gray, frame.width, frame.height, landmarks);
+    tracked_rect_ = rect;
+    tracked_centers_ = GetFaceCenters(landmarks);
+  }
+
+  // Timestamps of raw input may all be 0, assume 30 fps then
+  float dt = frame.ts > last_frame_ts_ ? (frame.ts - last_frame_ts_) / 1000.0f : 1.0f / 30;
+  last_frame_ts_ = frame.ts;
+  smoother_.setParameters(smoothing_min_cutoff_, smoothing_beta_);
+  smoother_.filter(landmarks, dt);
+  AppendDerivedPoints(landmarks);
+  return true;
+}
+
+std::vector<float> FaceDetector::GetFaceCenters(const std::vector<float>& landmarks) {
+  size_t faces = landmarks.size() / (kModelPointsPerFace * 2);
+  std::vector<float> centers(faces * 2, 0.0f);
+  for (size_t face = 0; face < faces; face++) {
+    const float* points = landmarks.data() + face * kModelPointsPerFace * 2;
+    for (int i = 0; i < kModelPointsPerFace; i++) {
+      centers[face * 2] += points[i * 2];
+      centers[face * 2 + 1] += points[i * 2 + 1];
+    }
+    centers[face * 2] /= kModelPointsPerFace;
+    centers[face * 2 + 1] /= kModelPointsPerFace;
+  }
+  return centers;
+}
+
+// Detection sorts faces by size, which can swap two similar faces between
+// detections. Keep the order of the tracked faces so the smoother never
+// blends points of different faces.
+void FaceDetector::MatchFaceOrder(std::vector<float>& landmarks, std::vector<float>& rect) const {
+  std::vector<float> centers = GetFaceCenters(landmarks);
+  size_t faces = centers.size() / 2;
+  if (faces < 2 || tracked_centers_.size() != centers.size() || rect.size() != faces * 4) {
+    return;
+  }
+  std::vector<int> order(faces, -1);
+  std::vector<bool> used(faces, false);
+  for (size_t previous = 0; previous < faces; previous++) {
+    float best = 0.0f;
+    for (size_t face = 0; face < faces; face++) {
+      if (used[face]) {
+        continue;
+      }
+      float dx = centers[face * 2] - tracked_centers_[previous * 2];
+      float dy = centers[face * 2 + 1] - tracked_centers_[previous * 2 + 1];
+      float distance = dx * dx + dy * dy;
+      if (order[previous] < 0 || distance < best) {
+        order[previous] = (int)face;
+        best = distance;
+      }
+    }
+    used[order[previous]] = true;
+  }
+
+  std::vector<float> sortedLandmarks;
+  std::vector<float> sortedRect;
+  for (int face : order) {
+    sortedLandmarks.insert(sortedLandmarks.end(),
+                           landmarks.begin() + face * kModelPointsPerFace * 2,
+                           landmarks.begin() + (face + 1) * kModelPointsPerFace * 2);
+    sortedRect.insert(sortedRect.end(), rect.begin() + face * 4, rect.begin() + face * 4 + 4);
+  }
+  landmarks.swap(sortedLandmarks);
+  rect.swap(sortedRect);
+}
+
+int64_t FaceDetector::DispatchLatestResult() {
+  std::vector<float> landmarks;
+  std::vector<float> rect;
+  int64_t ts;
+  {
+    // Never wait for the worker, a result it is publishing right now is
+    // picked up on the next call
+    std::unique_lock<std::mutex> lock(result_mutex_, std::try_to_lock);
+    if (!lock.owns_lock() || !result_pending_) {
+      return -1;
+    }
+    landmarks = std::move(result_landmarks_);
+    rect = std::move(result_rect_);
+    ts = result_ts_;
+    result_pending_ = false;
+  }
+
+  for(auto cb : _face_detector_callbacks) {
+    cb(landmarks, rect);
+  }
+  return ts;
+}
+
+int FaceDetector::DetectLandmarks(const uint8_t* data,
+                    int width,
+                    int height,
+                    GPUPIXEL_MODE_FMT fmt,
+                    GPUPIXEL_FRAME_TYPE type,
+                    std::vector<float>& landmarks,
+                    std::vector<float>& rect) {
   if(vnn_handle_ == 0) {
     return -1;
   }
+  std::lock_guard<std::mutex> lock(vnn_mutex_);
   
   VNN_Set_Face_Attr(vnn_handle_, "_use_278pts", &use_278pts);
 
@@ -85,56 +367,61 @@ int FaceDetector::Detect(const uint8_t* data,
   VNN_FaceFrameDataArr expanded_output;
   ret = VNN_Get_Face_Attr(vnn_handle_, "_detection_data", &expanded_output);
  
-  std::vector<float> landmarks;
-  std::vector<float> rect;
-  if(output.facesNum > 0 && expanded_output.facesNum > 0) {
-    rect.push_back(expanded_output.facesArr[0].faceRect.x0);   // left
-    rect.push_back(expanded_output.facesArr[0].faceRect.y0);   // top
-    rect.push_back(expanded_output.facesArr[0].faceRect.x1);   // right
-    rect.push_back(expanded_output.facesArr[0].faceRect.y1);   // bottom
-
-    for (int i = 0; i < output.facesArr[0].faceLandmarksNum; i++) {
-      landmarks.push_back(output.facesArr[0].faceLandmarks[i].x);
-      landmarks.push_back(output.facesArr[0].faceLandmarks[i].y);
+  int faces = std::min((int)output.facesNum, (int)expanded_output.facesNum);
+  faces = std::min(faces, kMaxFaces);
+  std::vector<int> order;
+  for (int i = 0; i < faces; i++) {
+    if (output.facesArr[i].faceLandmarksNum >= kModelPointsPerFace) {
+      order.push_back(i);
     }
-
-    // 106
-    auto point_x = (output.facesArr[0].faceLandmarks[102].x + output.facesArr[0].faceLandmarks[98].x)/2;
-    auto point_y = (output.facesArr[0].faceLandmarks[102].y + output.facesArr[0].faceLandmarks[98].y)/2;
-    landmarks.push_back(point_x);
-    landmarks.push_back(point_y);
-    
-    // 107
-    point_x = (output.facesArr[0].faceLandmarks[35].x + output.facesArr[0].faceLandmarks[65].x)/2;
-    point_y = (output.facesArr[0].faceLandmarks[35].y + output.facesArr[0].faceLandmarks[65].y)/2;
-    landmarks.push_back(point_x);
-    landmarks.push_back(point_y);
-    
-    
-    // 108
-    point_x = (output.facesArr[0].faceLandmarks[70].x + output.facesArr[0].faceLandmarks[40].x)/2;
-    point_y = (output.facesArr[0].faceLandmarks[70].y + output.facesArr[0].faceLandmarks[40].y)/2;
-    landmarks.push_back(point_x);
-    landmarks.push_back(point_y);
-    
-    // 109
-    point_x = (output.facesArr[0].faceLandmarks[5].x + output.facesArr[0].faceLandmarks[80].x)/2;
-    point_y = (output.facesArr[0].faceLandmarks[5].y + output.facesArr[0].faceLandmarks[80].y)/2;
-    landmarks.push_back(point_x);
-    landmarks.push_back(point_y);
-
-    // 110
-    point_x = (output.facesArr[0].faceLandmarks[81].x + output.facesArr[0].faceLandmarks[27].x)/2;
-    point_y = (output.facesArr[0].faceLandmarks[81].y + output.facesArr[0].faceLandmarks[27].y)/2;
-    landmarks.push_back(point_x);
-    landmarks.push_back(point_y);
   }
-  
-  // do callbck
-  for(auto cb : _face_detector_callbacks) {
-    cb(landmarks, rect);
+  // Largest face first, callers that handle one face keep the main one
+  auto area = [&](int i) {
+    const VNN_Rect2D& r = expanded_output.facesArr[i].faceRect;
+    return std::fabs((r.x1 - r.x0) * (r.y1 - r.y0));
+  };
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+    return area(a) > area(b);
+  });
+
+  for (int face : order) {
+    rect.push_back(expanded_output.facesArr[face].faceRect.x0);   // left
+    rect.push_back(expanded_output.facesArr[face].faceRect.y0);   // top
+    rect.push_back(expanded_output.facesArr[face].faceRect.x1);   // right
+    rect.push_back(expanded_output.facesArr[face].faceRect.y1);   // bottom
+
+    for (int i = 0; i < kModelPointsPerFace; i++) {
+      landmarks.push_back(output.facesArr[face].faceLandmarks[i].x);
+      landmarks.push_back(output.facesArr[face].faceLandmarks[i].y);
+    }
   }
   return 0;
 }
 
+// Points 106 to 110 are midpoints the makeup and reshape filters expect
+// after the 106 model points of every face
+void FaceDetector::AppendDerivedPoints(std::vector<float>& landmarks) {
+  static const int pairs[][2] = {
+    {102, 98},  // 106
+    {35, 65},   // 107
+    {70, 40},   // 108
+    {5, 80},    // 109
+    {81, 27},   // 110
+  };
+  size_t faces = landmarks.size() / (kModelPointsPerFace * 2);
+  std::vector<float> expanded;
+  expanded.reserve(faces * kLandmarksPerFace * 2);
+  for (size_t face = 0; face < faces; face++) {
+    const float* points = landmarks.data() + face * kModelPointsPerFace * 2;
+    expanded.insert(expanded.end(), points, points + kModelPointsPerFace * 2);
+    for (const auto& pair : pairs) {
+      auto point_x = (points[pair[0] * 2] + points[pair[1] * 2])/2;
+      auto point_y = (points[pair[0] * 2 + 1] + points[pair[1] * 2 + 1])/2;
+      expanded.push_back(point_x);
+      expanded.push_back(point_y);
+    }
+  }
+  landmarks.swap(expanded);
+}
+
 NS_GPUPIXEL_END
@@ -8,9 +8,14 @@
 #pragma once
 
 #include <stdlib.h>
+#include <atomic>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include "gpupixel_macros.h"
+#include "landmark_tracker.h"
 
 NS_GPUPIXEL_BEGIN
 GPUPIXEL_API typedef std::function<void(std::vector<float> landmarks, std::vector<float> rect)>
@@ -30,6 +35,13 @@ GPUPIXEL_API typedef enum {
 
 class GPUPIXEL_API FaceDetector {
     public:
+        // Callbacks get the faces one after another, largest first:
+        // kLandmarksPerFace (x, y) points and 4 rect values per face. The
+        // points are the 106 model points followed by 5 derived ones.
+        static constexpr int kModelPointsPerFace = 106;
+        static constexpr int kLandmarksPerFace = 111;
+        static constexpr int kMaxFaces = 5;
+
         FaceDetector();
 
         ~FaceDetector();
@@ -39,11 +51,92 @@ class GPUPIXEL_API FaceDetector {
                     int height,
                     GPUPIXEL_MODE_FMT fmt,
                     GPUPIXEL_FRAME_TYPE type);
+
+        // Non-blocking video detection. The frame is downscaled into a single
+        // slot mailbox, replacing a frame the worker thread hasn't picked up
+        // yet, so detection always runs on the newest frame and never delays
+        // the caller. stride is in bytes.
+        void DetectAsync(const uint8_t* rgba, int width, int height, int stride,
+                         int64_t ts);
+        void DetectAsync(int width, int height,
+                         const uint8_t* dataY, int strideY,
+                         const uint8_t* dataU, int strideU,
+                         const uint8_t* dataV, int strideV,
+                         int64_t ts);
+
+        // Runs the callbacks with the newest result the worker published since
+        // the last call, on the calling thread. Returns the timestamp of the
+        // frame it was detected on, or -1 if there is nothing new.
+        int64_t DispatchLatestResult();
+
+        // Video frames between two full detections, the frames in between
+        // are tracked with optical flow. 1 detects every frame.
+        void SetDetectionInterval(int frames);
+        // One-Euro smoothing of the video landmarks, see LandmarkSmoother
+        void SetSmoothing(float minCutoff, float beta);
       
         int RegCallback(FaceDetectorCallback callback);
     private:
+        struct DetectionFrame {
+            std::vector<uint8_t> data;
+            int width = 0;
+            int height = 0;
+            GPUPIXEL_FRAME_TYPE type = GPUPIXEL_FRAME_TYPE_UNKNOW;
+            int64_t ts = 0;
+        };
+
+        // Longer side of the frames handed to the worker
+        static constexpr int kMaxDetectionSize = 640;
+
+        int DetectLandmarks(const uint8_t* data,
+                            int width,
+                            int height,
+                            GPUPIXEL_MODE_FMT fmt,
+                            GPUPIXEL_FRAME_TYPE type,
+                            std::vector<float>& landmarks,
+                            std::vector<float>& rect);
+        bool ProcessVideoFrame(const DetectionFrame& frame,
+                               std::vector<float>& landmarks,
+                               std::vector<float>& rect);
+        static void AppendDerivedPoints(std::vector<float>& landmarks);
+        static std::vector<float> GetFaceCenters(const std::vector<float>& landmarks);
+        void MatchFaceOrder(std::vector<float>& landmarks, std::vector<float>& rect) const;
+        void GetDetectionSize(int width, int height, int& outWidth, int& outHeight) const;
+        DetectionFrame* AcquireFrame();
+        void PostFrame(DetectionFrame* frame);
+        void WorkerLoop();
+
         uint32_t vnn_handle_;
         int use_278pts = 0;
         std::vector<FaceDetectorCallback> _face_detector_callbacks;
+        std::mutex vnn_mutex_;
+
+        // mailbox_ holds the newest undetected frame, spare_ a consumed one to
+        // recycle. Both are only ever swapped, never locked.
+        std::atomic<DetectionFrame*> mailbox_{nullptr};
+        std::atomic<DetectionFrame*> spare_{nullptr};
+        std::thread worker_;
+        std::mutex worker_mutex_;
+        std::condition_variable worker_cv_;
+        bool worker_stop_ = false;
+
+        std::mutex result_mutex_;
+        bool result_pending_ = false;
+        int64_t result_ts_ = 0;
+        std::vector<float> result_landmarks_;
+        std::vector<float> result_rect_;
+
+        // Worker thread only
+        static constexpr float kMinTrackingConfidence = 0.8f;
+        std::atomic<int> detection_interval_{5};
+        std::atomic<float> smoothing_min_cutoff_{1.5f};
+        std::atomic<float> smoothing_beta_{5.0f};
+        LandmarkTracker tracker_;
+        LandmarkSmoother smoother_;
+        std::vector<uint8_t> gray_;
+        std::vector<float> tracked_rect_;
+        std::vector<float> tracked_centers_;
+        int frames_since_detection_ = 0;
+        int64_t last_frame_ts_ = 0;
     };
 NS_GPUPIXEL_END
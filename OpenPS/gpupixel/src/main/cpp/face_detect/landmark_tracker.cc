@@ -0,0 +1,235 @@
+/*
+ * LandmarkTracker
+ */
+
+#include "landmark_tracker.h"
+#include <algorithm>
+#include <cmath>
+
+NS_GPUPIXEL_BEGIN
+
+namespace {
+constexpr int kPyramidLevels = 3;
+constexpr int kMinLevelSize = 32;
+constexpr int kWindowRadius = 4;
+constexpr int kWindowSize = (2 * kWindowRadius + 1) * (2 * kWindowRadius + 1);
+constexpr int kMaxIterations = 10;
+constexpr float kMinEigenvalue = 0.25f;
+constexpr float kMaxMeanError = 20.0f;
+constexpr float kDerivativeCutoff = 1.0f;
+
+inline float sample(const uint8_t* pixels, int width, int height, float x, float y) {
+  x = std::min(std::max(x, 0.0f), (float) (width - 1));
+  y = std::min(std::max(y, 0.0f), (float) (height - 1));
+  int x0 = (int) x;
+  int y0 = (int) y;
+  int x1 = std::min(x0 + 1, width - 1);
+  int y1 = std::min(y0 + 1, height - 1);
+  float fx = x - x0;
+  float fy = y - y0;
+  const uint8_t* row0 = pixels + y0 * width;
+  const uint8_t* row1 = pixels + y1 * width;
+  float top = row0[x0] + (row0[x1] - row0[x0]) * fx;
+  float bottom = row1[x0] + (row1[x1] - row1[x0]) * fx;
+  return top + (bottom - top) * fy;
+}
+
+inline float smoothingFactor(float cutoff, float dt) {
+  float tau = 1.0f / (2.0f * (float) M_PI * cutoff);
+  return 1.0f / (1.0f + tau / dt);
+}
+}  // namespace
+
+void LandmarkTracker::reset(const uint8_t* gray, int width, int height,
+                            const std::vector<float>& landmarks) {
+  buildPyramid(gray, width, height, _prevPyramid);
+  _landmarks = landmarks;
+}
+
+void LandmarkTracker::clear() {
+  _landmarks.clear();
+}
+
+float LandmarkTracker::track(const uint8_t* gray, int width, int height,
+                             std::vector<float>& landmarks) {
+  if (!isTracking() || _prevPyramid.empty() ||
+      _prevPyramid[0].width != width || _prevPyramid[0].height != height) {
+    return 0.0f;
+  }
+  buildPyramid(gray, width, height, _nextPyramid);
+
+  size_t count = _landmarks.size() / 2;
+  std::vector<float> moved(_landmarks.size());
+  std::vector<bool> good(count);
+  std::vector<float> dxs;
+  std::vector<float> dys;
+  for (size_t i = 0; i < count; ++i) {
+    float x = _landmarks[i * 2] * width;
+    float y = _landmarks[i * 2 + 1] * height;
+    float outX, outY;
+    good[i] = trackPoint(x, y, outX, outY);
+    if (good[i]) {
+      moved[i * 2] = outX / width;
+      moved[i * 2 + 1] = outY / height;
+      dxs.push_back(outX - x);
+      dys.push_back(outY - y);
+    }
+  }
+  if (dxs.empty()) {
+    clear();
+    return 0.0f;
+  }
+
+  auto median = [](std::vector<float>& v) {
+    std::nth_element(v.begin(), v.begin() + v.size() / 2, v.end());
+    return v[v.size() / 2];
+  };
+  float medianX = median(dxs) / width;
+  float medianY = median(dys) / height;
+  for (size_t i = 0; i < count; ++i) {
+    if (!good[i]) {
+      moved[i * 2] = _landmarks[i * 2] + medianX;
+      moved[i * 2 + 1] = _landmarks[i * 2 + 1] + medianY;
+    }
+  }
+
+  std::swap(_prevPyramid, _nextPyramid);
+  _landmarks = moved;
+  landmarks = std::move(moved);
+  return (float) dxs.size() / count;
+}
+
+void LandmarkTracker::buildPyramid(const uint8_t* gray, int width, int height,
+                                   std::vector<Level>& pyramid) const {
+  pyramid.resize(1);
+  pyramid[0].width = width;
+  pyramid[0].height = height;
+  pyramid[0].pixels.assign(gray, gray + (size_t) width * height);
+
+  while ((int) pyramid.size() < kPyramidLevels) {
+    const Level& src = pyramid.back();
+    if (src.width / 2 < kMinLevelSize || src.height / 2 < kMinLevelSize) {
+      break;
+    }
+    Level dst;
+    dst.width = src.width / 2;
+    dst.height = src.height / 2;
+    dst.pixels.resize((size_t) dst.width * dst.height);
+    for (int y = 0; y < dst.height; ++y) {
+      const uint8_t* row0 = src.pixels.data() + (y * 2) * src.width;
+      const uint8_t* row1 = row0 + src.width;
+      uint8_t* out = dst.pixels.data() + y * dst.width;
+      for (int x = 0; x < dst.width; ++x) {
+        out[x] = (uint8_t) ((row0[x * 2] + row0[x * 2 + 1] +
+                             row1[x * 2] + row1[x * 2 + 1] + 2) >> 2);
+      }
+    }
+    pyramid.push_back(std::move(dst));
+  }
+}
+
+bool LandmarkTracker::trackPoint(float x, float y, float& outX, float& outY) const {
+  float template_[kWindowSize];
+  float gradX[kWindowSize];
+  float gradY[kWindowSize];
+  float guessX = 0.0f;
+  float guessY = 0.0f;
+  float meanError = 0.0f;
+
+  for (int level = (int) _prevPyramid.size() - 1; level >= 0; --level) {
+    const Level& prev = _prevPyramid[level];
+    const Level& next = _nextPyramid[level];
+    float scale = 1.0f / (1 << level);
+    float px = x * scale;
+    float py = y * scale;
+
+    float gxx = 0.0f, gxy = 0.0f, gyy = 0.0f;
+    int k = 0;
+    for (int j = -kWindowRadius; j <= kWindowRadius; ++j) {
+      for (int i = -kWindowRadius; i <= kWindowRadius; ++i, ++k) {
+        const uint8_t* p = prev.pixels.data();
+        template_[k] = sample(p, prev.width, prev.height, px + i, py + j);
+        gradX[k] = (sample(p, prev.width, prev.height, px + i + 1, py + j) -
+                    sample(p, prev.width, prev.height, px + i - 1, py + j)) * 0.5f;
+        gradY[k] = (sample(p, prev.width, prev.height, px + i, py + j + 1) -
+                    sample(p, prev.width, prev.height, px + i, py + j - 1)) * 0.5f;
+        gxx += gradX[k] * gradX[k];
+        gxy += gradX[k] * gradY[k];
+        gyy += gradY[k] * gradY[k];
+      }
+    }
+    float det = gxx * gyy - gxy * gxy;
+    float minEigen = (gxx + gyy - std::sqrt((gxx - gyy) * (gxx - gyy) + 4.0f * gxy * gxy)) *
+                     0.5f / kWindowSize;
+    if (minEigen < kMinEigenvalue || det <= 0.0f) {
+      return false;
+    }
+
+    float dx = 0.0f;
+    float dy = 0.0f;
+    for (int iteration = 0; iteration < kMaxIterations; ++iteration) {
+      float bx = 0.0f, by = 0.0f;
+      meanError = 0.0f;
+      k = 0;
+      for (int j = -kWindowRadius; j <= kWindowRadius; ++j) {
+        for (int i = -kWindowRadius; i <= kWindowRadius; ++i, ++k) {
+          float diff = template_[k] - sample(next.pixels.data(), next.width, next.height,
+                                             px + guessX + dx + i, py + guessY + dy + j);
+          bx += diff * gradX[k];
+          by += diff * gradY[k];
+          meanError += std::fabs(diff);
+        }
+      }
+      meanError /= kWindowSize;
+      float stepX = (gyy * bx - gxy * by) / det;
+      float stepY = (gxx * by - gxy * bx) / det;
+      dx += stepX;
+      dy += stepY;
+      if (stepX * stepX + stepY * stepY < 1e-4f) {
+        break;
+      }
+    }
+
+    if (level > 0) {
+      guessX = (guessX + dx) * 2.0f;
+      guessY = (guessY + dy) * 2.0f;
+    } else {
+      guessX += dx;
+      guessY += dy;
+    }
+  }
+
+  outX = x + guessX;
+  outY = y + guessY;
+  const Level& base = _nextPyramid[0];
+  return meanError <= kMaxMeanError && outX >= 0.0f && outY >= 0.0f &&
+         outX < base.width && outY < base.height;
+}
+
+void LandmarkSmoother::setParameters(float minCutoff, float beta) {
+  _minCutoff = minCutoff;
+  _beta = beta;
+}
+
+void LandmarkSmoother::clear() {
+  _values.clear();
+  _derivatives.clear();
+}
+
+void LandmarkSmoother::filter(std::vector<float>& values, float dt) {
+  if (_values.size() != values.size() || dt <= 0.0f) {
+    _values = values;
+    _derivatives.assign(values.size(), 0.0f);
+    return;
+  }
+  float derivativeAlpha = smoothingFactor(kDerivativeCutoff, dt);
+  for (size_t i = 0; i < values.size(); ++i) {
+    float derivative = (values[i] - _values[i]) / dt;
+    _derivatives[i] += derivativeAlpha * (derivative - _derivatives[i]);
+    float cutoff = _minCutoff + _beta * std::fabs(_derivatives[i]);
+    _values[i] += smoothingFactor(cutoff, dt) * (values[i] - _values[i]);
+    values[i] = _values[i];
+  }
+}
+
+NS_GPUPIXEL_END
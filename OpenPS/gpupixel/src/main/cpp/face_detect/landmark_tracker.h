@@ -0,0 +1,76 @@
+/*
+ * LandmarkTracker
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "gpupixel_macros.h"
+
+NS_GPUPIXEL_BEGIN
+
+/**
+ * Carries landmarks from one frame to the next with pyramidal Lucas-Kanade
+ * optical flow, so the face model only has to run every few frames.
+ * Landmarks are normalized (x, y) pairs, the same layout FaceDetector emits.
+ */
+class GPUPIXEL_API LandmarkTracker {
+ public:
+  /**
+   * Starts tracking from landmarks detected on this 8-bit gray frame.
+   */
+  void reset(const uint8_t* gray, int width, int height,
+             const std::vector<float>& landmarks);
+
+  /**
+   * Moves the tracked landmarks onto this frame. Returns the fraction of
+   * points that were followed reliably, 0 when nothing is tracked or the frame
+   * size changed. Points that were lost take the median motion of the rest.
+   */
+  float track(const uint8_t* gray, int width, int height,
+              std::vector<float>& landmarks);
+
+  void clear();
+  bool isTracking() const { return !_landmarks.empty(); }
+
+ private:
+  struct Level {
+    std::vector<uint8_t> pixels;
+    int width = 0;
+    int height = 0;
+  };
+
+  void buildPyramid(const uint8_t* gray, int width, int height,
+                    std::vector<Level>& pyramid) const;
+  bool trackPoint(float x, float y, float& outX, float& outY) const;
+
+  std::vector<Level> _prevPyramid;
+  std::vector<Level> _nextPyramid;
+  std::vector<float> _landmarks;
+};
+
+/**
+ * One-Euro filter over a landmark vector. Slow motion is smoothed hard to
+ * remove jitter, fast motion passes with little lag.
+ */
+class GPUPIXEL_API LandmarkSmoother {
+ public:
+  void setParameters(float minCutoff, float beta);
+
+  /**
+   * Filters the values in place. dt is the time since the previous call in
+   * seconds. A change in the number of values restarts the filter.
+   */
+  void filter(std::vector<float>& values, float dt);
+
+  void clear();
+
+ private:
+  float _minCutoff = 1.5f;
+  float _beta = 5.0f;
+  std::vector<float> _values;
+  std::vector<float> _derivatives;
+};
+
+NS_GPUPIXEL_END
@@ -57,6 +57,17 @@ void BeautyFaceFilter::setInputFramebuffer(
     std::shared_ptr<Framebuffer> framebuffer,
     RotationMode rotationMode /* = NoRotation*/,
     int texIdx /* = 0*/) {
+  // The unit filter only shades inside the skin mask bounds, so the blur and
+  // high pass only have to cover those plus the taps of their own passes
+  if (framebuffer) {
+    int width = framebuffer->getWidth();
+    int height = framebuffer->getHeight();
+    int margin = boxBlurFilter->getSampleFootprint(width, height) +
+                 boxHighPassFilter->getSampleFootprint(width, height);
+    const Vector4& bounds = beautyFilter->getSkinMaskBounds();
+    boxBlurFilter->setScissorRegion(bounds, margin);
+    boxHighPassFilter->setScissorRegion(bounds, margin);
+  }
   for (auto& filter : _filters) {
     filter->setInputFramebuffer(framebuffer, rotationMode, texIdx);
   }
@@ -83,6 +94,11 @@ void BeautyFaceFilter::setRadius(float radius) {
   boxHighPassFilter->setRadius(radius);
 }
 
+void BeautyFaceFilter::setTexelSpacingMultiplier(float value) {
+  boxBlurFilter->setTexelSpacingMultiplier(value);
+  boxHighPassFilter->setTexelSpacingMultiplier(value);
+}
+
 void BeautyFaceFilter::updateSkinMask(std::string fileName) {
   beautyFilter->updateSkinMaskTexture(fileName);
 }
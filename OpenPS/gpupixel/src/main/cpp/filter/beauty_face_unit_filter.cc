@@ -6,6 +6,8 @@
  */
 
 #include "beauty_face_unit_filter.h"
+#include <algorithm>
+#include <future>
 #include "gpupixel_context.h"
 #include "source_image.h"
 
@@ -52,6 +54,7 @@ NS_GPUPIXEL_BEGIN
     uniform sampler2D lookUpSkin;
     uniform sampler2D lookUpCustom;
     uniform sampler2D skinMask;
+    uniform highp vec4 imageRegion;
 
     uniform highp float sharpen;
     uniform highp float blurAlpha;
@@ -65,7 +68,7 @@ NS_GPUPIXEL_BEGIN
       vec4 iColor = texture2D(inputImageTexture, textureCoordinate);
       vec4 meanColor = texture2D(inputImageTexture2, textureCoordinate);
       vec4 varColor = texture2D(inputImageTexture3, textureCoordinate);
-      vec4 skinMaskColor = texture2D(skinMask, textureCoordinate);
+      vec4 skinMaskColor = texture2D(skinMask, imageRegion.xy + textureCoordinate * imageRegion.zw);
 
       vec3 color = iColor.rgb;
       if (blurAlpha > 0.0) {
@@ -289,7 +292,12 @@ NS_GPUPIXEL_BEGIN
 
     BeautyFaceUnitFilter::BeautyFaceUnitFilter() {}
 
-    BeautyFaceUnitFilter::~BeautyFaceUnitFilter() {}
+    BeautyFaceUnitFilter::~BeautyFaceUnitFilter() {
+        if (copyProgram_) {
+            delete copyProgram_;
+            copyProgram_ = nullptr;
+        }
+    }
 
     std::shared_ptr<BeautyFaceUnitFilter> BeautyFaceUnitFilter::create() {
         auto ret = std::shared_ptr<BeautyFaceUnitFilter>(new BeautyFaceUnitFilter());
@@ -300,31 +308,78 @@ NS_GPUPIXEL_BEGIN
     }
 
     bool BeautyFaceUnitFilter::init() {
+        // Decoding the lookup tables and the mask costs far more than uploading
+        // them. Decode in parallel while the shaders compile, only the uploads
+        // stay on the GL thread. Paths are resolved here, that may need JNI.
+        auto decode = [](const std::string& name, int desiredChannels) {
+            return std::async(std::launch::async, SourceImage::decode,
+                              Util::getResourcePath(name), desiredChannels);
+        };
+        auto gray = decode("lookup_gray.png", 0);
+        auto origin = decode("lookup_origin.png", 0);
+        auto skin = decode("lookup_skin.png", 0);
+        auto custom = decode("lookup_light.png", 0);
+        auto skinMask = decode("skin_mask.png", 1);
+
         if (!Filter::initWithShaderString(kGPUImageBaseBeautyFaceVertexShaderString,
                                           kGPUImageBaseBeautyFaceFragmentShaderString,
                                           3)) {
             return false;
         }
 
-        grayImage_ = SourceImage::create(Util::getResourcePath("lookup_gray.png"));
-        originImage_ = SourceImage::create(Util::getResourcePath("lookup_origin.png"));
-        skinImage_ = SourceImage::create(Util::getResourcePath("lookup_skin.png"));
-        customImage_ = SourceImage::create(Util::getResourcePath("lookup_light.png"));
-        skinMaskImage_ = SourceImage::create(Util::getResourcePath("skin_mask.png"));
+        grayImage_ = SourceImage::create_from_pixels(gray.get());
+        originImage_ = SourceImage::create_from_pixels(origin.get());
+        skinImage_ = SourceImage::create_from_pixels(skin.get());
+        customImage_ = SourceImage::create_from_pixels(custom.get());
+        SourceImage::Pixels mask = skinMask.get();
+        if (mask.data) {
+            loadSkinMask(mask.data.get(), mask.width, mask.height);
+        }
+
+        // copies the pixels outside of the skin mask bounds
+        copyProgram_ = GLProgram::createByShaderString(kDefaultVertexShader,
+                                                       kDefaultFragmentShader);
+        copyPositionAttribute_ = copyProgram_->getAttribLocation("position");
+        copyTexCoordAttribute_ =
+            copyProgram_->getAttribLocation("inputTextureCoordinate");
         return true;
     }
 
     bool BeautyFaceUnitFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
-        static const GLfloat imageVertices[] = {
-            -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-        };
+        // Where the skin mask is zero the shader returns its input, so only
+        // the mask bounds are shaded, on top of a copy of the input. Bounds
+        // are in image space, move them into the tile.
+        int scissorX, scissorY, scissorWidth, scissorHeight;
+        bool fullFrame = !_getScissorRect(skinMaskBounds_, 0, scissorX, scissorY,
+                                          scissorWidth, scissorHeight);
 
-        GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
         _framebuffer->active();
         CHECK_GL(glClearColor(_backgroundColor.r, _backgroundColor.g,
                               _backgroundColor.b, _backgroundColor.a));
         CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
 
+        if (!fullFrame) {
+            GPUPixelContext::getInstance()->setActiveShaderProgram(copyProgram_);
+            CHECK_GL(glActiveTexture(GL_TEXTURE2));
+            CHECK_GL(glBindTexture(GL_TEXTURE_2D,
+                                   _inputFramebuffers[0].frameBuffer->getTexture()));
+            copyProgram_->setUniformValue("inputImageTexture", 2);
+            copyProgram_->setUniformValue("mvpMatrix", Matrix4::IDENTITY);
+            CHECK_GL(glEnableVertexAttribArray(copyPositionAttribute_));
+            GPUPixelContext::getInstance()->setQuadPositionAttribute(copyPositionAttribute_);
+            CHECK_GL(glEnableVertexAttribArray(copyTexCoordAttribute_));
+            GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+                copyTexCoordAttribute_, _inputFramebuffers[0].rotationMode);
+            CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+            CHECK_GL(glDisableVertexAttribArray(copyTexCoordAttribute_));
+            if (scissorWidth == 0 || scissorHeight == 0) {
+                _framebuffer->inactive();
+                return Source::proceed(bUpdateTargets, frameTime);
+            }
+        }
+
+        GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
+
         CHECK_GL(glActiveTexture(GL_TEXTURE2));
         CHECK_GL(glBindTexture(GL_TEXTURE_2D,
                                _inputFramebuffers[0].frameBuffer->getTexture()));
@@ -344,9 +399,8 @@ NS_GPUPIXEL_BEGIN
         GLuint filterTexCoordAttribute =
             _filterProgram->getAttribLocation("inputTextureCoordinate");
         CHECK_GL(glEnableVertexAttribArray(filterTexCoordAttribute));
-        CHECK_GL(glVertexAttribPointer(
-            filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-            _getTexureCoordinate(_inputFramebuffers[0].rotationMode)));
+        GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+            filterTexCoordAttribute, _inputFramebuffers[0].rotationMode);
 
         glActiveTexture(GL_TEXTURE5);
         glBindTexture(GL_TEXTURE_2D, grayImage_->getFramebuffer()->getTexture());
@@ -367,17 +421,25 @@ NS_GPUPIXEL_BEGIN
         glActiveTexture(GL_TEXTURE8);
         glBindTexture(GL_TEXTURE_2D, skinMaskImage_->getFramebuffer()->getTexture());
         _filterProgram->setUniformValue("skinMask", 8);
+        _filterProgram->setUniformValue("imageRegion", _imageRegion);
 
         // vertex position
-        CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                       imageVertices));
+        CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
+        GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
         _filterProgram->setUniformValue("sharpen", sharpen_);
         _filterProgram->setUniformValue("blurAlpha", blurAlpha_);
         _filterProgram->setUniformValue("whiten", white_);
 
         // draw
+        if (!fullFrame) {
+            CHECK_GL(glEnable(GL_SCISSOR_TEST));
+            CHECK_GL(glScissor(scissorX, scissorY, scissorWidth, scissorHeight));
+        }
         CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+        if (!fullFrame) {
+            CHECK_GL(glDisable(GL_SCISSOR_TEST));
+        }
 
         _framebuffer->inactive();
 
@@ -401,7 +463,46 @@ NS_GPUPIXEL_BEGIN
     }
 
   void BeautyFaceUnitFilter::updateSkinMaskTexture(std::string fileName) {
-      skinMaskImage_ = SourceImage::create(Util::getResourcePath(fileName));
+      SourceImage::Pixels mask = SourceImage::decode(Util::getResourcePath(fileName), 1);
+      if (mask.data) {
+          loadSkinMask(mask.data.get(), mask.width, mask.height);
+      }
   }
 
+    void BeautyFaceUnitFilter::loadSkinMask(const unsigned char* data, int width, int height) {
+        int minX = width, minY = height, maxX = -1, maxY = -1;
+        for (int y = 0; y < height; y++) {
+            const unsigned char* row = data + (size_t) y * width;
+            int first = 0;
+            while (first < width && row[first] == 0) {
+                first++;
+            }
+            if (first == width) {
+                continue;
+            }
+            int last = width - 1;
+            while (row[last] == 0) {
+                last--;
+            }
+            minX = std::min(minX, first);
+            maxX = std::max(maxX, last);
+            minY = std::min(minY, y);
+            maxY = y;
+        }
+        if (maxX < 0) {
+            skinMaskBounds_ = Vector4(0.0, 0.0, 0.0, 0.0);
+        } else {
+            // One texel of margin, the mask is sampled with linear filtering
+            minX = std::max(minX - 1, 0);
+            minY = std::max(minY - 1, 0);
+            maxX = std::min(maxX + 2, width);
+            maxY = std::min(maxY + 2, height);
+            skinMaskBounds_ = Vector4((float) minX / width, (float) minY / height,
+                                      (float) (maxX - minX) / width,
+                                      (float) (maxY - minY) / height);
+        }
+
+        skinMaskImage_ = SourceImage::create_from_memory(width, height, 1, data);
+    }
+
 NS_GPUPIXEL_END
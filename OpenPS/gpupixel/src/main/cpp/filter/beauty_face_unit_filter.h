@@ -25,6 +25,10 @@ class GPUPIXEL_API BeautyFaceUnitFilter : public Filter {
   void setWhite(float white);
   void updateSkinMaskTexture(std::string fileName);
 
+  // Normalized rect (x, y, width, height) of the image holding every non-zero
+  // skin mask pixel. Outside of it the filter is a plain copy.
+  const Vector4& getSkinMaskBounds() const { return skinMaskBounds_; }
+
  protected:
   BeautyFaceUnitFilter();
 
@@ -35,6 +39,12 @@ class GPUPIXEL_API BeautyFaceUnitFilter : public Filter {
   std::shared_ptr<SourceImage> skinMaskImage_;
 
  private:
+  void loadSkinMask(const unsigned char* data, int width, int height);
+
+  Vector4 skinMaskBounds_ = Vector4(0.0, 0.0, 1.0, 1.0);
+  GLProgram* copyProgram_ = nullptr;
+  GLuint copyPositionAttribute_ = 0;
+  GLuint copyTexCoordAttribute_ = 0;
   float sharpen_ = 0.0;
   float blurAlpha_ = 0.0;
   float white_ = 0.0;
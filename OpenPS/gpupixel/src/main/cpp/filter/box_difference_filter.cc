@@ -82,12 +82,15 @@ bool BoxDifferenceFilter::init() {
 }
 
 bool BoxDifferenceFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
-  static const GLfloat imageVertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
-
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   _framebuffer->active();
+  int scissorX, scissorY, scissorWidth, scissorHeight;
+  bool scissor = _getScissorRect(_scissorRegion, _scissorMargin, scissorX,
+                                 scissorY, scissorWidth, scissorHeight);
+  if (scissor) {
+    CHECK_GL(glEnable(GL_SCISSOR_TEST));
+    CHECK_GL(glScissor(scissorX, scissorY, scissorWidth, scissorHeight));
+  }
   CHECK_GL(glClearColor(_backgroundColor.r, _backgroundColor.g,
                         _backgroundColor.b, _backgroundColor.a));
   CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
@@ -105,24 +108,24 @@ bool BoxDifferenceFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   _filterProgram->setUniformValue("inputImageTexture2", 1);
 
   CHECK_GL(glEnableVertexAttribArray(filterTexCoordAttribute_));
-  CHECK_GL(glVertexAttribPointer(
-      filterTexCoordAttribute_, 2, GL_FLOAT, 0, 0,
-      _getTexureCoordinate(_inputFramebuffers[0].rotationMode)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      filterTexCoordAttribute_, _inputFramebuffers[0].rotationMode);
 
   CHECK_GL(glEnableVertexAttribArray(filterTexCoordAttribute2_));
-  CHECK_GL(glVertexAttribPointer(
-      filterTexCoordAttribute2_, 2, GL_FLOAT, 0, 0,
-      _getTexureCoordinate(_inputFramebuffers[1].rotationMode)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      filterTexCoordAttribute2_, _inputFramebuffers[1].rotationMode);
 
   // vertex position
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
   // update uniform
   _filterProgram->setUniformValue("delta", delta_);
 
   // draw
   CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  if (scissor) {
+    CHECK_GL(glDisable(GL_SCISSOR_TEST));
+  }
 
   _framebuffer->inactive();
 
@@ -56,4 +56,8 @@ void BoxHighPassFilter::setDelta(float delta) {
   boxDifferenceFilter->setDelta(delta);
 }
 
+void BoxHighPassFilter::setTexelSpacingMultiplier(float value) {
+  boxBlurFilter->setTexelSpacingMultiplier(value);
+}
+
 NS_GPUPIXEL_END
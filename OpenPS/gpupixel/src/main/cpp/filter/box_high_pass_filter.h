@@ -21,6 +21,7 @@ class GPUPIXEL_API BoxHighPassFilter : public FilterGroup {
 
   void setRadius(float radius);
   void setDelta(float delta);
+  void setTexelSpacingMultiplier(float value);
 
   virtual void setInputFramebuffer(std::shared_ptr<Framebuffer> framebuffer,
                                    RotationMode rotationMode /* = NoRotation*/,
@@ -56,6 +56,12 @@ bool CannyEdgeDetectionFilter::init() {
       ->addTarget(_weakPixelInclusionFilter);
   addFilter(_grayscaleFilter);
 
+  // Luminance and its blur are only read through .r by the next pass
+  _grayscaleFilter->setOutputTextureAttributes(
+      Framebuffer::singleChannelTextureAttributes());
+  _blurFilter->setOutputTextureAttributes(
+      Framebuffer::singleChannelTextureAttributes());
+
   return true;
 }
 
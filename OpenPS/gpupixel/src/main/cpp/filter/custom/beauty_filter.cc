@@ -1,4 +1,5 @@
 #include "beauty_filter.h"
+#include <cmath>
 
 USING_NS_GPUPIXEL
 
@@ -146,6 +147,15 @@ void BeautyFilter::setTexelSize(int textureWidth, int textureHeight) {
   texelSizeY = textureHeight;
 }
 
+int BeautyFilter::getSampleFootprint(int width, int height) const {
+  if (texelSizeX <= 0 || texelSizeY <= 0) {
+    return 0;
+  }
+  // Outermost blur sample is 10 steps of 2 texels away
+  return (int)std::ceil(20.0 * std::max((float)width / texelSizeX,
+                                        (float)height / texelSizeY));
+}
+
 bool BeautyFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   _filterProgram->setUniformValue("params", Vector4(0.33f, 0.63f, 0.4f, 0.35f));
   _filterProgram->setUniformValue("singleStepOffset", Vector2(2.0f / texelSizeX, 2.0f / texelSizeY));
@@ -12,6 +12,7 @@ public:
   void setIntensity(float newIntensity);
   bool init();
   void setTexelSize(int textureWidth, int textureHeight);
+  virtual int getSampleFootprint(int width, int height) const override;
   virtual bool proceed(bool bUpdateTargets = true, int64_t frameTime = 0) override;
 
 private:
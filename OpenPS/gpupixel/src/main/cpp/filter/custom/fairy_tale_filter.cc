@@ -71,10 +71,6 @@ void FairyTaleFilter::setIntensity(float newIntensity) {
 }
 
 bool FairyTaleFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
-  static const GLfloat imageVertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
-
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   _framebuffer->active();
   CHECK_GL(glClearColor(_backgroundColor.r, _backgroundColor.g,
@@ -90,9 +86,8 @@ bool FairyTaleFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   GLuint filterTexCoordAttribute =
       _filterProgram->getAttribLocation("inputTextureCoordinate");
   CHECK_GL(glEnableVertexAttribArray(filterTexCoordAttribute));
-  CHECK_GL(glVertexAttribPointer(
-      filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-      _getTexureCoordinate(_inputFramebuffers[0].rotationMode)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      filterTexCoordAttribute, _inputFramebuffers[0].rotationMode);
 
   CHECK_GL(glActiveTexture(GL_TEXTURE3));
   CHECK_GL(glBindTexture(GL_TEXTURE_2D,fairyTaleImage->getFramebuffer()->getTexture()));
@@ -101,8 +96,7 @@ bool FairyTaleFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   _filterProgram->setUniformValue("intensity", intensity);
 
   // vertex position
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
   // draw
   CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
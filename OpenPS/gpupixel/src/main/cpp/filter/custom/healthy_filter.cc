@@ -8,6 +8,7 @@ const std::string kHealthyFragmentShaderString = SHADER_STRING(
   uniform sampler2D inputImageTexture;
   uniform sampler2D curve;
   uniform sampler2D mask;
+  uniform vec4 imageRegion;
 
   uniform float texelWidthOffset;
 
@@ -82,7 +83,7 @@ const std::string kHealthyFragmentShaderString = SHADER_STRING(
 
     vec4 textureColor;
 
-    vec4 t0 = texture2D(mask, vec2(textureCoordinate.x, textureCoordinate.y));
+    vec4 t0 = texture2D(mask, imageRegion.xy + textureCoordinate * imageRegion.zw);
 
     // naver skin
     vec4 c2 = texture2D(inputImageTexture, textureCoordinate);
@@ -144,8 +145,10 @@ bool HealthyFilter::init() {
   if (!initWithFragmentShaderString(kHealthyFragmentShaderString)) {
     return false;
   }
-  maskImage = SourceImage::create(Util::getResourcePath("healthy_mask_1.jpg"));
-  curveImage = SourceImage::create(Util::getResourcePath("lookup_healthy.png"));
+  auto images = SourceImage::create_all({Util::getResourcePath("healthy_mask_1.jpg"),
+                                         Util::getResourcePath("lookup_healthy.png")});
+  maskImage = images[0];
+  curveImage = images[1];
   return true;
 }
 
@@ -165,6 +168,7 @@ bool HealthyFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   CHECK_GL(glBindTexture(GL_TEXTURE_2D, maskImage->getFramebuffer()->getTexture()))
   _filterProgram->setUniformValue("curve", 3);
   _filterProgram->setUniformValue("mask", 4);
+  _filterProgram->setUniformValue("imageRegion", _imageRegion);
   _filterProgram->setUniformValue("texelWidthOffset", 1.0f / texelSizeX);
   _filterProgram->setUniformValue("texelHeightOffset", 1.0f / texelSizeY);
   _filterProgram->setUniformValue("intensity", intensity);
@@ -1,4 +1,5 @@
 #include "skin_whiten_filter.h"
+#include <cmath>
 
 USING_NS_GPUPIXEL
 
@@ -128,6 +129,15 @@ void SkinWhitenFilter::setTexelSize(int textureWidth, int textureHeight) {
   texelSizeY = textureHeight;
 }
 
+int SkinWhitenFilter::getSampleFootprint(int width, int height) const {
+  if (texelSizeX <= 0 || texelSizeY <= 0) {
+    return 0;
+  }
+  // Outermost gaussian tap
+  return (int)std::ceil(5.37754 * std::max((float)width / texelSizeX,
+                                        (float)height / texelSizeY));
+}
+
 bool SkinWhitenFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   CHECK_GL(glActiveTexture(GL_TEXTURE3))
   CHECK_GL(glBindTexture(GL_TEXTURE_2D, curveImage->getFramebuffer()->getTexture()))
@@ -153,10 +153,14 @@ bool SunriseFilter::init() {
   if (!initWithFragmentShaderString(kSunriseFragmentShaderString)) {
     return false;
   }
-  curveImage = SourceImage::create(Util::getResourcePath("lookup_sunrise.png"));
-  greyMaskImage1 = SourceImage::create(Util::getResourcePath("amaro_mask1.jpg"));
-  greyMaskImage2 = SourceImage::create(Util::getResourcePath("amaro_mask2.jpg"));
-  greyMaskImage3 = SourceImage::create(Util::getResourcePath("toy_mask1.jpg"));
+  auto images = SourceImage::create_all({Util::getResourcePath("lookup_sunrise.png"),
+                                         Util::getResourcePath("amaro_mask1.jpg"),
+                                         Util::getResourcePath("amaro_mask2.jpg"),
+                                         Util::getResourcePath("toy_mask1.jpg")});
+  curveImage = images[0];
+  greyMaskImage1 = images[1];
+  greyMaskImage2 = images[2];
+  greyMaskImage3 = images[3];
   return true;
 }
 
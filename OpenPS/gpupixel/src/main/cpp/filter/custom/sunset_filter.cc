@@ -127,9 +127,12 @@ bool SunsetFilter::init() {
   if (!initWithFragmentShaderString(kSunsetFragmentShaderString)) {
     return false;
   }
-  curveImage = SourceImage::create(Util::getResourcePath("lookup_sunset.png"));
-  greyMaskImage1 = SourceImage::create(Util::getResourcePath("rise_mask1.jpg"));
-  greyMaskImage2 = SourceImage::create(Util::getResourcePath("rise_mask2.jpg"));
+  auto images = SourceImage::create_all({Util::getResourcePath("lookup_sunset.png"),
+                                         Util::getResourcePath("rise_mask1.jpg"),
+                                         Util::getResourcePath("rise_mask2.jpg")});
+  curveImage = images[0];
+  greyMaskImage1 = images[1];
+  greyMaskImage2 = images[2];
   return true;
 }
 
@@ -9,163 +9,67 @@
 #include "gpupixel_context.h"
 #include "source_image.h"
 #include "face_detector.h"
+#include <algorithm>
 
 NS_GPUPIXEL_BEGIN
 
 const std::string FaceMakeupFilterVertexShaderString = R"(
     attribute vec3 position; attribute vec2 inputTextureCoordinate;
     varying vec2 textureCoordinate;
-    varying vec2 textureCoordinate2;
     uniform mat4 mvpMatrix;
 
     void main(void) {
       gl_Position = mvpMatrix * vec4(position, 1.);
       textureCoordinate = inputTextureCoordinate;
-      textureCoordinate2 = position.xy * 0.5 + 0.5;  // landmark
     })";
+
+// Makeup is multiply blended: bg * (1 - a) + bg * fg * a. The shader writes
+// the factor (1 - a + fg * a) and the blend unit multiplies the framebuffer
+// with it, so layers stack in one framebuffer without reading it back.
 #if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
 const std::string FaceMakeupFilterFragmentShaderString = R"(
-    precision mediump float; 
+    precision mediump float;
     varying highp vec2 textureCoordinate;
-    varying highp vec2 textureCoordinate2;
-    uniform sampler2D inputImageTexture;
-    uniform sampler2D inputImageTexture2;  // mouth
+    uniform sampler2D inputImageTexture2;  // makeup
 
     uniform float intensity;
-    uniform int blendMode;
-
-    float blendHardLight(float base, float blend) {
-      return blend < 0.5 ? (2.0 * base * blend)
-                         : (1.0 - 2.0 * (1.0 - base) * (1.0 - blend));
-    }
-
-    vec3 blendHardLight(vec3 base, vec3 blend) {
-      return vec3(blendHardLight(base.r, blend.r),
-                  blendHardLight(base.g, blend.g),
-                  blendHardLight(base.b, blend.b));
-    }
-
-    float blendSoftLight(float base, float blend) {
-      return (blend < 0.5) ? (base + (2.0 * blend - 1.0) * (base - base * base))
-                           : (base + (2.0 * blend - 1.0) * (sqrt(base) - base));
-    } vec3 blendSoftLight(vec3 base, vec3 blend) {
-      return vec3(blendSoftLight(base.r, blend.r),
-                  blendSoftLight(base.g, blend.g),
-                  blendSoftLight(base.b, blend.b));
-    }
-
-    vec3 blendMultiply(vec3 base, vec3 blend) { return base * blend; }
-
-    float blendOverlay(float base, float blend) {
-      return base < 0.5 ? (2.0 * base * blend)
-                        : (1.0 - 2.0 * (1.0 - base) * (1.0 - blend));
-    } vec3 blendOverlay(vec3 base, vec3 blend) {
-      return vec3(blendOverlay(base.r, blend.r), blendOverlay(base.g, blend.g),
-                  blendOverlay(base.b, blend.b));
-    }
-
-    vec3 blendFunc(vec3 base, vec3 blend, int blendMode) {
-      if (blendMode == 0) {
-        return blend;
-      } else if (blendMode == 15) {
-        return blendMultiply(base, blend);
-      } else if (blendMode == 17) {
-        return blendOverlay(base, blend);
-      } else if (blendMode == 22) {
-        return blendHardLight(base, blend);
-      }
-      return blend;
-    }
 
     void main() {
-      vec4 fgColor = texture2D(inputImageTexture2, textureCoordinate);  // mouth
+      vec4 fgColor = texture2D(inputImageTexture2, textureCoordinate);
       fgColor = fgColor * intensity;
-      vec4 bgColor = texture2D(inputImageTexture, textureCoordinate2);
       if (fgColor.a == 0.0) {
-        gl_FragColor = bgColor;
+        gl_FragColor = vec4(1.0);
         return;
       }
 
-      vec3 color = blendFunc(bgColor.rgb,
-                             clamp(fgColor.rgb * (1.0 / fgColor.a), 0.0, 1.0),
-                             blendMode);
-      //    color = color * intensity;
-      gl_FragColor =
-          vec4(bgColor.rgb * (1.0 - fgColor.a) + color.rgb * fgColor.a, 1.0);
+      vec3 color = clamp(fgColor.rgb * (1.0 / fgColor.a), 0.0, 1.0);
+      gl_FragColor = vec4(vec3(1.0 - fgColor.a) + color * fgColor.a, 1.0);
     })";
 #elif defined(GPUPIXEL_MAC) || defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
 const std::string FaceMakeupFilterFragmentShaderString = R"(
     varying vec2 textureCoordinate;
-    varying vec2 textureCoordinate2;
-    uniform sampler2D inputImageTexture;
-    uniform sampler2D inputImageTexture2;  // mouth
+    uniform sampler2D inputImageTexture2;  // makeup
 
     uniform float intensity;
-    uniform int blendMode;
-
-    float blendHardLight(float base, float blend) {
-      return blend < 0.5 ? (2.0 * base * blend)
-                         : (1.0 - 2.0 * (1.0 - base) * (1.0 - blend));
-    }
-
-    vec3 blendHardLight(vec3 base, vec3 blend) {
-      return vec3(blendHardLight(base.r, blend.r),
-                  blendHardLight(base.g, blend.g),
-                  blendHardLight(base.b, blend.b));
-    }
-
-    float blendSoftLight(float base, float blend) {
-      return (blend < 0.5) ? (base + (2.0 * blend - 1.0) * (base - base * base))
-                           : (base + (2.0 * blend - 1.0) * (sqrt(base) - base));
-    } vec3 blendSoftLight(vec3 base, vec3 blend) {
-      return vec3(blendSoftLight(base.r, blend.r),
-                  blendSoftLight(base.g, blend.g),
-                  blendSoftLight(base.b, blend.b));
-    }
-
-    vec3 blendMultiply(vec3 base, vec3 blend) { return base * blend; }
-
-    float blendOverlay(float base, float blend) {
-      return base < 0.5 ? (2.0 * base * blend)
-                        : (1.0 - 2.0 * (1.0 - base) * (1.0 - blend));
-    } vec3 blendOverlay(vec3 base, vec3 blend) {
-      return vec3(blendOverlay(base.r, blend.r), blendOverlay(base.g, blend.g),
-                  blendOverlay(base.b, blend.b));
-    }
-
-    vec3 blendFunc(vec3 base, vec3 blend, int blendMode) {
-      if (blendMode == 0) {
-        return blend;
-      } else if (blendMode == 15) {
-        return blendMultiply(base, blend);
-      } else if (blendMode == 17) {
-        return blendOverlay(base, blend);
-      } else if (blendMode == 22) {
-        return blendHardLight(base, blend);
-      }
-      return blend;
-    }
 
     void main() {
-      vec4 fgColor = texture2D(inputImageTexture2, textureCoordinate);  // mouth
+      vec4 fgColor = texture2D(inputImageTexture2, textureCoordinate);
       fgColor = fgColor * intensity;
-      vec4 bgColor = texture2D(inputImageTexture, textureCoordinate2);
       if (fgColor.a == 0.0) {
-        gl_FragColor = bgColor;
+        gl_FragColor = vec4(1.0);
         return;
       }
 
-      vec3 color = blendFunc(bgColor.rgb,
-                             clamp(fgColor.rgb * (1.0 / fgColor.a), 0.0, 1.0),
-                             blendMode);
-      //    color = color * intensity;
-      gl_FragColor =
-          vec4(bgColor.rgb * (1.0 - fgColor.a) + color.rgb * fgColor.a, 1.0);
+      vec3 color = clamp(fgColor.rgb * (1.0 / fgColor.a), 0.0, 1.0);
+      gl_FragColor = vec4(vec3(1.0 - fgColor.a) + color * fgColor.a, 1.0);
     })";
 #endif
 FaceMakeupFilter::FaceMakeupFilter() {}
 
-FaceMakeupFilter::~FaceMakeupFilter() {}
+FaceMakeupFilter::~FaceMakeupFilter() {
+  GLuint buffers[] = {position_buffer_, texture_coordinate_buffer_, index_buffer_};
+  CHECK_GL(glDeleteBuffers(3, buffers));
+}
 
 std::shared_ptr<FaceMakeupFilter> FaceMakeupFilter::create() {
   auto ret = std::shared_ptr<FaceMakeupFilter>(new FaceMakeupFilter());
@@ -193,6 +97,32 @@ bool FaceMakeupFilter::init() {
   _filterTexCoordAttribute2 =
       _filterProgram2->getAttribLocation("inputTextureCoordinate");
 
+  CHECK_GL(glGenBuffers(1, &position_buffer_));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, position_buffer_));
+  CHECK_GL(glBufferData(GL_ARRAY_BUFFER,
+                        FaceDetector::kMaxFaces * FaceDetector::kLandmarksPerFace * 2 *
+                            sizeof(GLfloat),
+                        nullptr, GL_DYNAMIC_DRAW));
+  CHECK_GL(glGenBuffers(1, &texture_coordinate_buffer_));
+  uploadTextureCoordinates();
+
+  // Every face uses the same triangles, offset to its own landmarks
+  auto face_indexs = getFaceIndexs();
+  indices_per_face_ = (GLsizei)face_indexs.size();
+  std::vector<GLushort> indices(face_indexs.size() * FaceDetector::kMaxFaces);
+  for (int face = 0; face < FaceDetector::kMaxFaces; face++) {
+    for (size_t i = 0; i < face_indexs.size(); i++) {
+      indices[face * face_indexs.size() + i] =
+          (GLushort)(face_indexs[i] + face * FaceDetector::kLandmarksPerFace);
+    }
+  }
+  CHECK_GL(glGenBuffers(1, &index_buffer_));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_));
+  CHECK_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort),
+                        indices.data(), GL_STATIC_DRAW));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  positions_.reserve(FaceDetector::kMaxFaces * FaceDetector::kLandmarksPerFace * 2);
+
   registerProperty("blend_level", 0, "The smoothing of filter with range between -1 and 1.", [this](float& val) {
       setBlendLevel(val);
   });
@@ -209,11 +139,7 @@ void FaceMakeupFilter::SetFaceLandmarks(std::vector<float> landmarks) {
     has_face_ = false;
     return;
   }
-  std::vector<float> vect;
-  for (auto it : landmarks) {
-    vect.push_back(2 * it - 1);
-  }
-  face_land_marks_ = vect;
+  face_land_marks_ = std::move(landmarks);
   has_face_ = true;
 }
 
@@ -221,15 +147,35 @@ void FaceMakeupFilter::setImageTexture(std::shared_ptr<SourceImage> texture) {
   image_texture_ = texture;
 }
 
+void FaceMakeupFilter::setTextureBounds(FrameBounds bounds) {
+  texture_bounds_ = bounds;
+  if (texture_coordinate_buffer_) {
+    uploadTextureCoordinates();
+  }
+}
+
+void FaceMakeupFilter::uploadTextureCoordinates() {
+  // The reference coordinates are relative to a 1280 x 1280 face, the makeup
+  // texture covers texture_bounds_ of it. Repeated for every face.
+  auto coord = faceTextureCoordinates();
+  std::vector<GLfloat> textureCoordinates(coord.size() * FaceDetector::kMaxFaces);
+  for (size_t i = 0; i + 1 < coord.size(); i += 2) {
+    textureCoordinates[i] = (coord[i] * 1280 - texture_bounds_.x) / texture_bounds_.width;
+    textureCoordinates[i + 1] =
+        (coord[i + 1] * 1280 - texture_bounds_.y) / texture_bounds_.height;
+  }
+  for (int face = 1; face < FaceDetector::kMaxFaces; face++) {
+    std::copy(textureCoordinates.begin(), textureCoordinates.begin() + coord.size(),
+              textureCoordinates.begin() + face * coord.size());
+  }
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, texture_coordinate_buffer_));
+  CHECK_GL(glBufferData(GL_ARRAY_BUFFER, textureCoordinates.size() * sizeof(GLfloat),
+                        textureCoordinates.data(), GL_STATIC_DRAW));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+}
 
-bool FaceMakeupFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
-  static const GLfloat imageVertices[] = {
-    -1.0f, -1.0f,
-    1.0f, -1.0f,
-    -1.0f, 1.0f,
-    1.0f, 1.0f,
-  };
 
+bool FaceMakeupFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
   _framebuffer->active();
   // render origin frame --- begin -----//
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram2);
@@ -245,61 +191,77 @@ bool FaceMakeupFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
 
   // vertex
   CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute2));
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute2, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute2);
 
   CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute2));
-  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute2, 2, GL_FLOAT, 0, 0,
-                                 _getTexureCoordinate(NoRotation)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      _filterTexCoordAttribute2, NoRotation);
 
   CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  CHECK_GL(glDisableVertexAttribArray(_filterTexCoordAttribute2));
+
+  // render makeup --- begin --- //
+  CHECK_GL(glEnable(GL_BLEND));
+  CHECK_GL(glBlendFunc(GL_ZERO, GL_SRC_COLOR));
+  drawMesh(_imageRegion);
+  for (auto& layer : layers_) {
+    layer->drawMesh(_imageRegion);
+  }
+  CHECK_GL(glDisable(GL_BLEND));
+  _framebuffer->inactive();
 
-  // render image --- begin --- //
-  GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
+  return Source::proceed(bUpdateTargets, frameTime);
+}
 
-  CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
-  if (face_land_marks_.size() != 0) {
-    CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                   face_land_marks_.data()));
+void FaceMakeupFilter::addLayer(std::shared_ptr<FaceMakeupFilter> layer) {
+  layers_.push_back(layer);
+}
+
+void FaceMakeupFilter::removeAllLayers() {
+  layers_.clear();
+}
+
+void FaceMakeupFilter::drawMesh(const Vector4& region) {
+  int faceCount = std::min((int)(face_land_marks_.size() / (FaceDetector::kLandmarksPerFace * 2)),
+                           FaceDetector::kMaxFaces);
+  if (!has_face_ || faceCount == 0 || blend_level_ == 0) {
+    return;
   }
+  GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
 
-  auto coord = this->faceTextureCoordinates();
-  std::vector<GLfloat> textureCoordinates(coord.size());
-  auto point_count = coord.size() / 2;
-  for (int i = 0; i < point_count; i++) {
-    textureCoordinates[i * 2 + 0] =
-        (coord[i * 2 + 0] * 1280 - texture_bounds_.x) / texture_bounds_.width;
-    textureCoordinates[i * 2 + 1] =
-        (coord[i * 2 + 1] * 1280 - texture_bounds_.y) / texture_bounds_.height;
+  // Landmarks are normalized to the full image, move them into the clip
+  // space of the tile covered by region
+  positions_.resize(faceCount * FaceDetector::kLandmarksPerFace * 2);
+  for (size_t i = 0; i < positions_.size(); i += 2) {
+    positions_[i] = 2 * (face_land_marks_[i] - region.x) / region.z - 1;
+    positions_[i + 1] = 2 * (face_land_marks_[i + 1] - region.y) / region.w - 1;
   }
-  // texcoord attribute
-  CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-                                 textureCoordinates.data()));
 
   _filterProgram->setUniformValue("intensity", this->blend_level_);
 
-  _filterProgram->setUniformValue("blendMode", 15);
-
-  std::shared_ptr<Framebuffer> fb = _inputFramebuffers[0].frameBuffer;
-  CHECK_GL(glActiveTexture(GL_TEXTURE0));
-  CHECK_GL(glBindTexture(GL_TEXTURE_2D, fb->getTexture()));
-  _filterProgram->setUniformValue("inputImageTexture", 0);  // origin image
-
   glActiveTexture(GL_TEXTURE3);
   // assert(image_texture_);
   glBindTexture(GL_TEXTURE_2D, image_texture_->getFramebuffer()->getTexture());
   _filterProgram->setUniformValue("inputImageTexture2", 3);
   _filterProgram->setUniformValue("mvpMatrix", Matrix4::IDENTITY);
 
-  if (has_face_) {
-    auto face_indexs = this->getFaceIndexs();
-    glDrawElements(GL_TRIANGLES, (GLsizei)face_indexs.size(), GL_UNSIGNED_INT,
-                   face_indexs.data());
-  }
-  _framebuffer->inactive();
-
-  return Source::proceed(bUpdateTargets, frameTime);
+  // All faces share one mesh and are drawn in a single call
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, position_buffer_));
+  CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, positions_.size() * sizeof(GLfloat),
+                           positions_.data()));
+  CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
+  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0, 0));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, texture_coordinate_buffer_));
+  CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute));
+  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute, 2, GL_FLOAT, 0, 0, 0));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer_));
+  CHECK_GL(glDrawElements(GL_TRIANGLES, indices_per_face_ * faceCount,
+                          GL_UNSIGNED_SHORT, 0));
+  // Later draws may use more vertices than this buffer holds, and expect no
+  // buffer bound
+  CHECK_GL(glDisableVertexAttribArray(_filterTexCoordAttribute));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 }
 
 std::vector<GLuint> FaceMakeupFilter::getFaceIndexs() {
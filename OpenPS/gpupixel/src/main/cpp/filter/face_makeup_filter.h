@@ -29,18 +29,30 @@ class GPUPIXEL_API FaceMakeupFilter : public Filter {
 
  
   inline void setBlendLevel(float level) { this->blend_level_ = level; }
+  // Landmarks of one or more faces, in the layout FaceDetector reports them
   void SetFaceLandmarks(std::vector<float> landmarks);
+
+  // Makeup filters drawn by this one, on the same copy of the input and in
+  // the same framebuffer. A layer keeps its own texture, level and
+  // landmarks but is not added to the pipeline itself.
+  void addLayer(std::shared_ptr<FaceMakeupFilter> layer);
+  void removeAllLayers();
  protected:
   FaceMakeupFilter();
   void setImageTexture(std::shared_ptr<SourceImage> texture);
-  void setTextureBounds(FrameBounds bounds) { texture_bounds_ = bounds; }
+  void setTextureBounds(FrameBounds bounds);
 
  private:
   std::vector<GLuint> getFaceIndexs();
   std::vector<GLfloat> faceTextureCoordinates();
+  void uploadTextureCoordinates();
+  void drawMesh(const Vector4& region);
 
  private:
+  // normalized to the full image
   std::vector<float> face_land_marks_;
+  // landmarks moved into the current tile, reused between frames
+  std::vector<GLfloat> positions_;
   float blend_level_ = 0;  //[0. 0.5]
   bool has_face_ = false;
   //
@@ -49,8 +61,16 @@ class GPUPIXEL_API FaceMakeupFilter : public Filter {
   GLuint _filterTexCoordAttribute = 0;
   GLuint _filterTexCoordAttribute2 = 0;
 
+  // The mesh topology and makeup texture coordinates never change, they are
+  // uploaded once for kMaxFaces faces. Only the positions stream per frame.
+  GLuint position_buffer_ = 0;
+  GLuint texture_coordinate_buffer_ = 0;
+  GLuint index_buffer_ = 0;
+  GLsizei indices_per_face_ = 0;
+
   FrameBounds texture_bounds_;
   std::shared_ptr<SourceImage> image_texture_;
+  std::vector<std::shared_ptr<FaceMakeupFilter>> layers_;
 };
 
 NS_GPUPIXEL_END
@@ -8,114 +8,25 @@
 #include "face_reshape_filter.h"
 #include "gpupixel_context.h"
 #include "face_detector.h"
+#include <algorithm>
+#include <cmath>
 NS_GPUPIXEL_BEGIN
 
-#if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_ANDROID)
-const std::string kGPUPixelThinFaceFragmentShaderString = R"(
- precision highp float;
- varying highp vec2 textureCoordinate;
- uniform sampler2D inputImageTexture;
-
- uniform int hasFace;
- uniform float facePoints[106 * 2];
-
- uniform highp float aspectRatio;
- uniform float thinFaceDelta;
- uniform float bigEyeDelta;
- 
- vec2 enlargeEye(vec2 textureCoord, vec2 originPosition, float radius, float delta) {
-
-     float weight = distance(vec2(textureCoord.x, textureCoord.y / aspectRatio), vec2(originPosition.x, originPosition.y / aspectRatio)) / radius;
-
-     weight = 1.0 - (1.0 - weight * weight) * delta;
-     weight = clamp(weight,0.0,1.0);
-     textureCoord = originPosition + (textureCoord - originPosition) * weight;
-     return textureCoord;
- }
- 
- vec2 curveWarp(vec2 textureCoord, vec2 originPosition, vec2 targetPosition, float delta) {
-
-     vec2 offset = vec2(0.0);
-     vec2 result = vec2(0.0);
-     vec2 direction = (targetPosition - originPosition) * delta;
-
-     float radius = distance(vec2(targetPosition.x, targetPosition.y / aspectRatio), vec2(originPosition.x, originPosition.y / aspectRatio));
-     float ratio = distance(vec2(textureCoord.x, textureCoord.y / aspectRatio), vec2(originPosition.x, originPosition.y / aspectRatio)) / radius;
-
-     ratio = 1.0 - ratio;
-     ratio = clamp(ratio, 0.0, 1.0);
-     offset = direction * ratio;
-
-     result = textureCoord - offset;
-
-     return result;
- }
-
- vec2 thinFace(vec2 currentCoordinate) {
-
-     vec2 faceIndexs[9];
-     faceIndexs[0] = vec2(3., 44.);
-     faceIndexs[1] = vec2(29., 44.);
-     faceIndexs[2] = vec2(7., 45.);
-     faceIndexs[3] = vec2(25., 45.);
-     faceIndexs[4] = vec2(10., 46.);
-     faceIndexs[5] = vec2(22., 46.);
-     faceIndexs[6] = vec2(14., 49.);
-     faceIndexs[7] = vec2(18., 49.);
-     faceIndexs[8] = vec2(16., 49.);
-
-     for(int i = 0; i < 9; i++)
-     {
-         int originIndex = int(faceIndexs[i].x);
-         int targetIndex = int(faceIndexs[i].y);
-         vec2 originPoint = vec2(facePoints[originIndex * 2], facePoints[originIndex * 2 + 1]);
-         vec2 targetPoint = vec2(facePoints[targetIndex * 2], facePoints[targetIndex * 2 + 1]);
-         currentCoordinate = curveWarp(currentCoordinate, originPoint, targetPoint, thinFaceDelta);
-     }
-     return currentCoordinate;
- }
-
- vec2 bigEye(vec2 currentCoordinate) {
-
-     vec2 faceIndexs[2];
-     faceIndexs[0] = vec2(74., 72.);
-     faceIndexs[1] = vec2(77., 75.);
-
-     for(int i = 0; i < 2; i++)
-     {
-         int originIndex = int(faceIndexs[i].x);
-         int targetIndex = int(faceIndexs[i].y);
-
-         vec2 originPoint = vec2(facePoints[originIndex * 2], facePoints[originIndex * 2 + 1]);
-         vec2 targetPoint = vec2(facePoints[targetIndex * 2], facePoints[targetIndex * 2 + 1]);
-
-         float radius = distance(vec2(targetPoint.x, targetPoint.y / aspectRatio), vec2(originPoint.x, originPoint.y / aspectRatio));
-         radius = radius * 5.;
-         currentCoordinate = enlargeEye(currentCoordinate, originPoint, radius, bigEyeDelta);
-     }
-     return currentCoordinate;
- }
-
- void main()
- {
-     vec2 positionToUse = textureCoordinate;
-
-     if (hasFace == 1) {
-         positionToUse = thinFace(positionToUse);
-         positionToUse = bigEye(positionToUse);
-     }
-
-     gl_FragColor = texture2D(inputImageTexture, positionToUse);
-
- }
- )";
-#elif defined(GPUPIXEL_MAC) || defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
-const std::string kGPUPixelThinFaceFragmentShaderString = R"(
+// The warp runs per vertex of a grid laid over each face's bounding box, the
+// rest of the image is a plain copy. position is the vertex inside gridBox,
+// the warped texture coordinate is where it samples. MAX_FACES is defined
+// in front of the source when the program is built.
+const std::string kGPUPixelFaceReshapeVertexShaderString = R"(
+ attribute vec2 position;
  varying vec2 textureCoordinate;
- uniform sampler2D inputImageTexture;
 
- uniform int hasFace;
- uniform float facePoints[106 * 2];
+ // Every face has 11 warps stored as (origin.xy, target.xy): 9 curve warps
+ // that slim the face, then the 2 eyes. faceBounds holds the box around all
+ // of a face's warps, points outside it skip that face.
+ uniform int faceCount;
+ uniform vec4 faceWarps[11 * MAX_FACES];
+ uniform vec4 faceBounds[MAX_FACES];
+ uniform vec4 gridBox;
 
  uniform float aspectRatio;
  uniform float thinFaceDelta;
@@ -125,8 +36,12 @@ const std::string kGPUPixelThinFaceFragmentShaderString = R"(
 
      float weight = distance(vec2(textureCoord.x, textureCoord.y / aspectRatio), vec2(originPosition.x, originPosition.y / aspectRatio)) / radius;
 
+     // Nothing at or beyond the radius moves. A positive delta samples closer
+     // to the origin and enlarges the eye, a negative one samples farther out
+     // and shrinks it, still from inside the radius.
+     weight = min(weight, 1.0);
      weight = 1.0 - (1.0 - weight * weight) * delta;
-     weight = clamp(weight,0.0,1.0);
+     weight = max(weight, 0.0);
      textureCoord = originPosition + (textureCoord - originPosition) * weight;
      return textureCoord;
  }
@@ -149,67 +64,59 @@ const std::string kGPUPixelThinFaceFragmentShaderString = R"(
      return result;
  }
 
- vec2 thinFace(vec2 currentCoordinate) {
-
-     vec2 faceIndexs[9];
-     faceIndexs[0] = vec2(3., 44.);
-     faceIndexs[1] = vec2(29., 44.);
-     faceIndexs[2] = vec2(7., 45.);
-     faceIndexs[3] = vec2(25., 45.);
-     faceIndexs[4] = vec2(10., 46.);
-     faceIndexs[5] = vec2(22., 46.);
-     faceIndexs[6] = vec2(14., 49.);
-     faceIndexs[7] = vec2(18., 49.);
-     faceIndexs[8] = vec2(16., 49.);
-
-     for(int i = 0; i < 9; i++)
-     {
-         int originIndex = int(faceIndexs[i].x);
-         int targetIndex = int(faceIndexs[i].y);
-         vec2 originPoint = vec2(facePoints[originIndex * 2], facePoints[originIndex * 2 + 1]);
-         vec2 targetPoint = vec2(facePoints[targetIndex * 2], facePoints[targetIndex * 2 + 1]);
-         currentCoordinate = curveWarp(currentCoordinate, originPoint, targetPoint, thinFaceDelta);
-     }
-     return currentCoordinate;
- }
-
- vec2 bigEye(vec2 currentCoordinate) {
-
-     vec2 faceIndexs[2];
-     faceIndexs[0] = vec2(74., 72.);
-     faceIndexs[1] = vec2(77., 75.);
-
-     for(int i = 0; i < 2; i++)
-     {
-         int originIndex = int(faceIndexs[i].x);
-         int targetIndex = int(faceIndexs[i].y);
-
-         vec2 originPoint = vec2(facePoints[originIndex * 2], facePoints[originIndex * 2 + 1]);
-         vec2 targetPoint = vec2(facePoints[targetIndex * 2], facePoints[targetIndex * 2 + 1]);
-
-         float radius = distance(vec2(targetPoint.x, targetPoint.y / aspectRatio), vec2(originPoint.x, originPoint.y / aspectRatio));
-         radius = radius * 5.;
-         currentCoordinate = enlargeEye(currentCoordinate, originPoint, radius, bigEyeDelta);
-     }
-     return currentCoordinate;
- }
-
  void main()
  {
-     vec2 positionToUse = textureCoordinate;
-
-     if (hasFace == 1) {
-         positionToUse = thinFace(positionToUse);
-         positionToUse = bigEye(positionToUse);
+     vec2 vertexPosition = mix(gridBox.xy, gridBox.zw, position);
+     vec2 positionToUse = vertexPosition;
+
+     for (int face = 0; face < MAX_FACES; face++) {
+         if (face >= faceCount) {
+             break;
+         }
+         vec4 bounds = faceBounds[face];
+         if (any(lessThan(positionToUse, bounds.xy)) || any(greaterThan(positionToUse, bounds.zw))) {
+             continue;
+         }
+
+         // thin face
+         for (int i = 0; i < 9; i++) {
+             vec4 warp = faceWarps[face * 11 + i];
+             positionToUse = curveWarp(positionToUse, warp.xy, warp.zw, thinFaceDelta);
+         }
+
+         // big eye
+         for (int i = 9; i < 11; i++) {
+             vec4 warp = faceWarps[face * 11 + i];
+             float radius = distance(vec2(warp.z, warp.w / aspectRatio), vec2(warp.x, warp.y / aspectRatio));
+             radius = radius * 5.;
+             positionToUse = enlargeEye(positionToUse, warp.xy, radius, bigEyeDelta);
+         }
      }
 
-     gl_FragColor = texture2D(inputImageTexture, positionToUse);
+     textureCoordinate = positionToUse;
+     gl_Position = vec4(vertexPosition * 2.0 - 1.0, 0.0, 1.0);
  }
  )";
-#endif
+
+namespace {
+// Mirrors the shader: the 9 thin face curve warps, then the 2 eyes
+const int kThinFacePairs[9][2] = {{3, 44},  {29, 44}, {7, 45},
+                                  {25, 45}, {10, 46}, {22, 46},
+                                  {14, 49}, {18, 49}, {16, 49}};
+const int kBigEyePairs[2][2] = {{74, 72}, {77, 75}};
+const int kWarpsPerFace = 11;
+}  // namespace
+
 FaceReshapeFilter::FaceReshapeFilter() {}
 
-FaceReshapeFilter::~FaceReshapeFilter() {}
+FaceReshapeFilter::~FaceReshapeFilter() {
+  if (_copyProgram) {
+    delete _copyProgram;
+    _copyProgram = nullptr;
+  }
+  GLuint buffers[] = {_gridVertexBuffer, _gridIndexBuffer};
+  CHECK_GL(glDeleteBuffers(2, buffers));
+}
 
 std::shared_ptr<FaceReshapeFilter> FaceReshapeFilter::create() {
   auto ret = std::shared_ptr<FaceReshapeFilter>(new FaceReshapeFilter());
@@ -220,9 +127,65 @@ std::shared_ptr<FaceReshapeFilter> FaceReshapeFilter::create() {
 }
 
 bool FaceReshapeFilter::init() {
-  if (!initWithFragmentShaderString(kGPUPixelThinFaceFragmentShaderString)) {
+  // Each face takes kWarpsPerFace + 1 vec4 uniforms. GLES 2.0 only
+  // guarantees 128 vertex uniform vectors, keep a few for the scalars.
+  GLint uniformVectors = 0;
+#if defined(GPUPIXEL_MAC) || defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+  // desktop GL reports scalar components rather than vec4 slots
+  GLint uniformComponents = 0;
+  CHECK_GL(glGetIntegerv(GL_MAX_VERTEX_UNIFORM_COMPONENTS, &uniformComponents));
+  uniformVectors = uniformComponents / 4;
+#else
+  CHECK_GL(glGetIntegerv(GL_MAX_VERTEX_UNIFORM_VECTORS, &uniformVectors));
+#endif
+  if (uniformVectors > 0) {
+    _maxFaces = std::max(1, std::min(FaceDetector::kMaxFaces,
+                                     (uniformVectors - 8) / (kWarpsPerFace + 1)));
+  }
+  if (!initWithShaderString(
+          Util::str_format("#define MAX_FACES %d\n", _maxFaces) +
+              kGPUPixelFaceReshapeVertexShaderString,
+          kDefaultFragmentShader)) {
     return false;
   }
+
+  // copies the pixels no face grid covers
+  _copyProgram = GLProgram::createByShaderString(kDefaultVertexShader,
+                                                 kDefaultFragmentShader);
+  _copyPositionAttribute = _copyProgram->getAttribLocation("position");
+  _copyTexCoordAttribute =
+      _copyProgram->getAttribLocation("inputTextureCoordinate");
+
+  // A (n + 1) x (n + 1) vertex grid over the unit square, shared by all faces
+  std::vector<GLfloat> gridVertices;
+  std::vector<GLushort> gridIndices;
+  for (int y = 0; y <= kGridSize; y++) {
+    for (int x = 0; x <= kGridSize; x++) {
+      gridVertices.push_back((float)x / kGridSize);
+      gridVertices.push_back((float)y / kGridSize);
+    }
+  }
+  for (int y = 0; y < kGridSize; y++) {
+    for (int x = 0; x < kGridSize; x++) {
+      GLushort topLeft = y * (kGridSize + 1) + x;
+      GLushort bottomLeft = topLeft + kGridSize + 1;
+      gridIndices.insert(gridIndices.end(), {topLeft, bottomLeft, (GLushort)(topLeft + 1),
+                                             (GLushort)(topLeft + 1), bottomLeft,
+                                             (GLushort)(bottomLeft + 1)});
+    }
+  }
+  CHECK_GL(glGenBuffers(1, &_gridVertexBuffer));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _gridVertexBuffer));
+  CHECK_GL(glBufferData(GL_ARRAY_BUFFER, gridVertices.size() * sizeof(GLfloat),
+                        gridVertices.data(), GL_STATIC_DRAW));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+  CHECK_GL(glGenBuffers(1, &_gridIndexBuffer));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _gridIndexBuffer));
+  CHECK_GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, gridIndices.size() * sizeof(GLushort),
+                        gridIndices.data(), GL_STATIC_DRAW));
+  CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  _gridIndexCount = (GLsizei)gridIndices.size();
+
     registerProperty("thin_face", 0, "The smoothing of filter with range between -1 and 1.", [this](float& val) {
         setFaceSlimLevel(val);
     });
@@ -252,20 +215,123 @@ void FaceReshapeFilter::SetFaceLandmarks(std::vector<float> landmarks) {
   has_face_ = true;
 }
 
+
 bool FaceReshapeFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
-  float aspect = (float)_framebuffer->getWidth() / _framebuffer->getHeight();
-  _filterProgram->setUniformValue("aspectRatio", aspect);
+  _framebuffer->active();
+  GPUPixelContext::getInstance()->setActiveShaderProgram(_copyProgram);
+  CHECK_GL(glClearColor(_backgroundColor.r, _backgroundColor.g,
+                        _backgroundColor.b, _backgroundColor.a));
+  CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
+  CHECK_GL(glActiveTexture(GL_TEXTURE0));
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D,
+                         _inputFramebuffers[0].frameBuffer->getTexture()));
+  _copyProgram->setUniformValue("inputImageTexture", 0);
+  _copyProgram->setUniformValue("mvpMatrix", Matrix4::IDENTITY);
+  CHECK_GL(glEnableVertexAttribArray(_copyPositionAttribute));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_copyPositionAttribute);
+  CHECK_GL(glEnableVertexAttribArray(_copyTexCoordAttribute));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      _copyTexCoordAttribute, _inputFramebuffers[0].rotationMode);
+  CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  // The grid draws below have far more vertices than this array
+  CHECK_GL(glDisableVertexAttribArray(_copyTexCoordAttribute));
+
+  int faceCount = has_face_ ? getFaceCount() : 0;
+  if (faceCount > 0 && (thinFaceDelta_ != 0 || bigEyeDelta_ != 0)) {
+    float aspect = (float)_framebuffer->getWidth() / _framebuffer->getHeight();
+    // Landmarks are normalized to the full image, move them into the tile.
+    // The warp works in pixel proportions, so the result matches an untiled
+    // render
+    std::vector<Vector4> warps(faceCount * kWarpsPerFace);
+    std::vector<Vector4> bounds(faceCount);
+    for (int face = 0; face < faceCount; face++) {
+      const float* points = face_land_marks_.data() + face * FaceDetector::kLandmarksPerFace * 2;
+      auto point = [&](int index, float& x, float& y) {
+        x = (points[index * 2] - _imageRegion.x) / _imageRegion.z;
+        y = (points[index * 2 + 1] - _imageRegion.y) / _imageRegion.w;
+      };
+      Vector4 box(1e6, 1e6, -1e6, -1e6);
+      // A warp moves nothing farther from its origin than its radius, measured
+      // with y divided by the aspect ratio like the shader does
+      auto addWarp = [&](int slot, int origin, int target, float radiusScale) {
+        Vector4& warp = warps[face * kWarpsPerFace + slot];
+        point(origin, warp.x, warp.y);
+        point(target, warp.z, warp.w);
+        float dx = warp.z - warp.x;
+        float dy = (warp.w - warp.y) / aspect;
+        float radius = std::sqrt(dx * dx + dy * dy) * radiusScale;
+        box.x = std::min(box.x, warp.x - radius);
+        box.y = std::min(box.y, warp.y - radius * aspect);
+        box.z = std::max(box.z, warp.x + radius);
+        box.w = std::max(box.w, warp.y + radius * aspect);
+      };
+      for (int i = 0; i < 9; i++) {
+        addWarp(i, kThinFacePairs[i][0], kThinFacePairs[i][1], 1);
+      }
+      for (int i = 0; i < 2; i++) {
+        addWarp(9 + i, kBigEyePairs[i][0], kBigEyePairs[i][1], 5);
+      }
+      bounds[face] = box;
+    }
+
+    GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
+    _filterProgram->setUniformValue("inputImageTexture", 0);
+    _filterProgram->setUniformValue("aspectRatio", aspect);
+    _filterProgram->setUniformValue("thinFaceDelta", this->thinFaceDelta_);
+    _filterProgram->setUniformValue("bigEyeDelta", this->bigEyeDelta_);
+    _filterProgram->setUniformValue("faceCount", faceCount);
+    _filterProgram->setUniformValue("faceWarps", warps.data(), (int)warps.size());
+    _filterProgram->setUniformValue("faceBounds", bounds.data(), faceCount);
+    CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _gridVertexBuffer));
+    CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0, 0));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _gridIndexBuffer));
+    for (int face = 0; face < faceCount; face++) {
+      // Only the part of the box inside this tile
+      Vector4 grid(std::max(bounds[face].x, 0.0f), std::max(bounds[face].y, 0.0f),
+                   std::min(bounds[face].z, 1.0f), std::min(bounds[face].w, 1.0f));
+      if (grid.x >= grid.z || grid.y >= grid.w) {
+        continue;
+      }
+      _filterProgram->setUniformValue("gridBox", grid);
+      CHECK_GL(glDrawElements(GL_TRIANGLES, _gridIndexCount, GL_UNSIGNED_SHORT, 0));
+    }
+    CHECK_GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+  }
+  _framebuffer->inactive();
 
-  _filterProgram->setUniformValue("thinFaceDelta", this->thinFaceDelta_);
+  return Source::proceed(bUpdateTargets, frameTime);
+}
 
-  _filterProgram->setUniformValue("bigEyeDelta", this->bigEyeDelta_);
+int FaceReshapeFilter::getFaceCount() const {
+  int faces = (int)(face_land_marks_.size() / (FaceDetector::kLandmarksPerFace * 2));
+  return std::min(faces, _maxFaces);
+}
 
-  _filterProgram->setUniformValue("hasFace", has_face_);
-  if (has_face_) {
-    _filterProgram->setUniformValue("facePoints", face_land_marks_.data(),
-                                    static_cast<int>(face_land_marks_.size()));
+int FaceReshapeFilter::getSampleFootprint(int width, int height) const {
+  if (!has_face_) {
+    return 0;
+  }
+  // Each curve warp moves a sample by at most |target - origin| * delta, each
+  // eye by radius * delta. Faces are warped one after another, so their
+  // footprints add up
+  float footprint = 0;
+  for (int face = 0; face < getFaceCount(); face++) {
+    const float* points = face_land_marks_.data() + face * FaceDetector::kLandmarksPerFace * 2;
+    auto pixelDistance = [&](int a, int b) {
+      float dx = (points[a * 2] - points[b * 2]) * width;
+      float dy = (points[a * 2 + 1] - points[b * 2 + 1]) * height;
+      return std::sqrt(dx * dx + dy * dy);
+    };
+    for (auto& pair : kThinFacePairs) {
+      footprint += pixelDistance(pair[0], pair[1]) * std::fabs(thinFaceDelta_);
+    }
+    for (auto& pair : kBigEyePairs) {
+      footprint += pixelDistance(pair[0], pair[1]) * 5 * std::fabs(bigEyeDelta_);
+    }
   }
-  return Filter::proceed(bUpdateTargets, frameTime);
+  return (int)std::ceil(footprint);
 }
 
 #pragma mark - face slim
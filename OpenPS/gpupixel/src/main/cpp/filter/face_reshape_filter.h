@@ -21,14 +21,29 @@ class GPUPIXEL_API FaceReshapeFilter : public Filter {
 
   void setFaceSlimLevel(float level);
   void setEyeZoomLevel(float level);
+  // Landmarks of one or more faces, in the layout FaceDetector reports them
   void SetFaceLandmarks(std::vector<float> landmarks);
+  virtual int getSampleFootprint(int width, int height) const override;
  protected:
   FaceReshapeFilter();
+  int getFaceCount() const;
   float thinFaceDelta_ = 0;
   float bigEyeDelta_ = 0;
 
   std::vector<float> face_land_marks_;
   int has_face_ = 0;
+
+ private:
+  // Grid cells per side of a face's warp box
+  static constexpr int kGridSize = 48;
+  // Faces the shader has uniforms for, limited by the device
+  int _maxFaces = FaceDetector::kMaxFaces;
+  GLProgram* _copyProgram = nullptr;
+  GLuint _copyPositionAttribute = 0;
+  GLuint _copyTexCoordAttribute = 0;
+  GLuint _gridVertexBuffer = 0;
+  GLuint _gridIndexBuffer = 0;
+  GLsizei _gridIndexCount = 0;
 };
 
 NS_GPUPIXEL_END
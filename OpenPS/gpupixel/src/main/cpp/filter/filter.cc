@@ -6,6 +6,8 @@
  */
 
 #include "filter.h"
+#include <algorithm>
+#include <cmath>
 #include "gpupixel.h"
 #include "gpupixel_context.h"
 
@@ -69,9 +71,11 @@ bool Filter::initWithShaderString(const std::string& vertexShaderSource,
   _inputNum = inputNumber;
   _filterProgram =
       GLProgram::createByShaderString(vertexShaderSource, fragmentShaderSource);
+#if defined(GPUPIXEL_ANDROID)
   if (_filterProgram != nullptr) {
     Util::onProgramCreated(_filterProgram->getID(), getFilterClassName().c_str(), false);
   }
+#endif
   _filterPositionAttribute = _filterProgram->getAttribLocation("position");
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
@@ -122,12 +126,15 @@ std::string Filter::_getVertexShaderString(int inputNumber) const {
 
 bool Filter::proceed(bool bUpdateTargets /* = true*/,
                      int64_t frametime /* = 0*/) {
-  static const GLfloat imageVertices[] = {
-      -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f,
-  };
-
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   _framebuffer->active();
+  int scissorX, scissorY, scissorWidth, scissorHeight;
+  bool scissor = _getScissorRect(_scissorRegion, _scissorMargin, scissorX,
+                                 scissorY, scissorWidth, scissorHeight);
+  if (scissor) {
+    CHECK_GL(glEnable(GL_SCISSOR_TEST));
+    CHECK_GL(glScissor(scissorX, scissorY, scissorWidth, scissorHeight));
+  }
   CHECK_GL(glClearColor(_backgroundColor.r, _backgroundColor.g,
                         _backgroundColor.b, _backgroundColor.a));
   CHECK_GL(glClear(GL_COLOR_BUFFER_BIT));
@@ -148,21 +155,48 @@ bool Filter::proceed(bool bUpdateTargets /* = true*/,
         texIdx == 0 ? "inputTextureCoordinate"
                     : Util::str_format("inputTextureCoordinate%d", texIdx));
     CHECK_GL(glEnableVertexAttribArray(filterTexCoordAttribute));
-    CHECK_GL(
-        glVertexAttribPointer(filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-                              _getTexureCoordinate(it->second.rotationMode)));
+    GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+        filterTexCoordAttribute, it->second.rotationMode);
   }
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
   CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+  if (scissor) {
+    CHECK_GL(glDisable(GL_SCISSOR_TEST));
+  }
 
   _framebuffer->inactive();
 
   return Source::proceed(bUpdateTargets, frametime);
 }
 
+bool Filter::_getScissorRect(const Vector4& region, int margin, int& x,
+                             int& y, int& width, int& height) const {
+  int fbWidth = _framebuffer->getWidth();
+  int fbHeight = _framebuffer->getHeight();
+  float left = (region.x - _imageRegion.x) / _imageRegion.z;
+  float bottom = (region.y - _imageRegion.y) / _imageRegion.w;
+  float right = left + region.z / _imageRegion.z;
+  float top = bottom + region.w / _imageRegion.w;
+  int x0 = std::max((int)std::floor(left * fbWidth) - margin, 0);
+  int y0 = std::max((int)std::floor(bottom * fbHeight) - margin, 0);
+  int x1 = std::min((int)std::ceil(right * fbWidth) + margin, fbWidth);
+  int y1 = std::min((int)std::ceil(top * fbHeight) + margin, fbHeight);
+  if (x0 == 0 && y0 == 0 && x1 == fbWidth && y1 == fbHeight) {
+    return false;
+  }
+  x = x0;
+  y = y0;
+  width = std::max(x1 - x0, 0);
+  height = std::max(y1 - y0, 0);
+  return true;
+}
+
 const GLfloat* Filter::_getTexureCoordinate(
     const RotationMode& rotationMode) const {
+  return getTextureCoordinates(rotationMode);
+}
+
+const GLfloat* Filter::getTextureCoordinates(RotationMode rotationMode) {
   static const GLfloat noRotationTextureCoordinates[] = {
     0.0f, 0.0f,
     1.0f, 0.0f,
@@ -247,6 +281,7 @@ const GLfloat* Filter::_getTexureCoordinate(
     default:
       break;
   }
+  return noRotationTextureCoordinates;
 }
 
 void Filter::update(int64_t frameTime) {
@@ -259,8 +294,11 @@ void Filter::update(int64_t frameTime) {
     int captureWidth = GPUPixelContext::getInstance()->captureWidth;
     int captureHeight = GPUPixelContext::getInstance()->captureHeight;
 
+    // Captures are read back as RGBA8, whatever the output format
     if (!_framebuffer || (_framebuffer->getWidth() != captureWidth ||
-                          _framebuffer->getHeight() != captureHeight)) {
+                          _framebuffer->getHeight() != captureHeight) ||
+        _framebuffer->getTextureAttributes() !=
+            Framebuffer::defaultTextureAttribures) {
       _framebuffer = GPUPixelContext::getInstance()
                          ->getFramebufferCache()
                          ->fetchFramebuffer(captureWidth, captureHeight);
@@ -300,11 +338,13 @@ void Filter::update(int64_t frameTime) {
     }
     if (!_framebuffer ||
         (_framebuffer->getWidth() != rotatedFramebufferWidth ||
-         _framebuffer->getHeight() != rotatedFramebufferHeight)) {
+         _framebuffer->getHeight() != rotatedFramebufferHeight) ||
+        _framebuffer->getTextureAttributes() != _outputTextureAttributes) {
       _framebuffer = GPUPixelContext::getInstance()
                          ->getFramebufferCache()
                          ->fetchFramebuffer(rotatedFramebufferWidth,
-                                            rotatedFramebufferHeight);
+                                            rotatedFramebufferHeight, false,
+                                            _outputTextureAttributes);
     }
     proceed(true, frameTime);
   }
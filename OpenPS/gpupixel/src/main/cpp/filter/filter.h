@@ -65,9 +65,11 @@ class GPUPIXEL_API Filter : public Source, public Target {
 
   void setFilterClassName(const std::string filterClassName) {
     _filterClassName = filterClassName;
+#if defined(GPUPIXEL_ANDROID)
     if (_filterProgram != nullptr) {
       Util::onProgramCreated(_filterProgram->getID(), getFilterClassName().c_str(), false);
     }
+#endif
   }
 
   std::string getFilterClassName() const { return _filterClassName; };
@@ -79,6 +81,38 @@ class GPUPIXEL_API Filter : public Source, public Target {
 
   GLProgram* getProgram() const { return _filterProgram; };
 
+  // Texture coordinates of the 4 vertex quad for an input with this rotation
+  static const GLfloat* getTextureCoordinates(RotationMode rotationMode);
+
+  // Largest distance, in pixels of a width x height output, between an output
+  // pixel and the input pixels it depends on. Tiled rendering sizes the tile
+  // overlap from it.
+  virtual int getSampleFootprint(int width, int height) const { return 0; }
+
+  // Normalized rect (x, y, width, height) of the full image covered by the
+  // input while the image is rendered in tiles. Filters sampling image aligned
+  // data such as landmarks or masks map it into the tile through this rect.
+  virtual void setImageRegion(const Vector4& region) { _imageRegion = region; }
+  const Vector4& getImageRegion() const { return _imageRegion; }
+
+  // Normalized rect (x, y, width, height) of the full image outside of which
+  // the output is never read. Drawing is scissored to it, moved into the tile
+  // and grown by margin output pixels for the samples downstream passes take.
+  virtual void setScissorRegion(const Vector4& region, int margin = 0) {
+    _scissorRegion = region;
+    _scissorMargin = margin;
+  }
+
+  // Format of the framebuffer this filter renders into. Filters whose output
+  // is only consumed internally can pick a narrower or more precise format
+  // than the RGBA8 default.
+  virtual void setOutputTextureAttributes(const TextureAttributes& attributes) {
+    _outputTextureAttributes = attributes;
+  }
+  const TextureAttributes& getOutputTextureAttributes() const {
+    return _outputTextureAttributes;
+  }
+
   // property setters & getters
   bool registerProperty(const std::string& name,
                         int defaultValue,
@@ -127,6 +161,11 @@ bool registerProperty(
   GLProgram* _filterProgram;
   GLuint _filterPositionAttribute;
   std::string _filterClassName;
+  Vector4 _imageRegion = Vector4(0.0, 0.0, 1.0, 1.0);
+  Vector4 _scissorRegion = Vector4(0.0, 0.0, 1.0, 1.0);
+  int _scissorMargin = 0;
+  TextureAttributes _outputTextureAttributes =
+      Framebuffer::defaultTextureAttribures;
   struct {
     float r;
     float g;
@@ -140,6 +179,11 @@ bool registerProperty(
 
   const GLfloat* _getTexureCoordinate(const RotationMode& rotationMode) const;
 
+  // Pixel rect of the output covering an image space region, false if that is
+  // the whole framebuffer. The rect may be empty.
+  bool _getScissorRect(const Vector4& region, int margin, int& x, int& y,
+                       int& width, int& height) const;
+
   // properties
   struct Property {
     std::string type;
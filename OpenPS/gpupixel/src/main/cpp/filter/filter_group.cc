@@ -196,6 +196,37 @@ bool FilterGroup::isPrepared() const {
   return true;
 }
 
+int FilterGroup::getSampleFootprint(int width, int height) const {
+  // Summing over all members is an upper bound for any topology of the group
+  int footprint = 0;
+  for (auto& filter : _filters) {
+    footprint += filter->getSampleFootprint(width, height);
+  }
+  return footprint;
+}
+
+void FilterGroup::setImageRegion(const Vector4& region) {
+  Filter::setImageRegion(region);
+  for (auto& filter : _filters) {
+    filter->setImageRegion(region);
+  }
+}
+
+void FilterGroup::setScissorRegion(const Vector4& region, int margin) {
+  Filter::setScissorRegion(region, margin);
+  for (auto& filter : _filters) {
+    filter->setScissorRegion(region, margin);
+  }
+}
+
+void FilterGroup::setOutputTextureAttributes(
+    const TextureAttributes& attributes) {
+  Filter::setOutputTextureAttributes(attributes);
+  if (_terminalFilter) {
+    _terminalFilter->setOutputTextureAttributes(attributes);
+  }
+}
+
 void FilterGroup::unPrepear() {
   // todo(Jeayo)
   // for (auto& filter : _filters) {
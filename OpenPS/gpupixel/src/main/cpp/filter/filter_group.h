@@ -63,6 +63,13 @@ class GPUPIXEL_API FilterGroup : public Filter {
   virtual bool isPrepared() const override;
   virtual void unPrepear() override;
 
+  virtual int getSampleFootprint(int width, int height) const override;
+  virtual void setImageRegion(const Vector4& region) override;
+  virtual void setScissorRegion(const Vector4& region, int margin = 0) override;
+  // Applies to the terminal filter, the members render into their own formats
+  virtual void setOutputTextureAttributes(
+      const TextureAttributes& attributes) override;
+
  protected:
   std::vector<std::shared_ptr<Filter>> _filters;
   std::shared_ptr<Filter> _terminalFilter;
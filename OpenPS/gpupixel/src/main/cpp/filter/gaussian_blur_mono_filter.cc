@@ -120,6 +120,12 @@ void GaussianBlurMonoFilter::setTexelSpacingMultiplier(float value) {
   horizontalTexelSpacing_ = value;
 }
 
+int GaussianBlurMonoFilter::getSampleFootprint(int width, int height) const {
+  // The outermost optimized offset sits half a texel beyond the radius
+  return (int)std::ceil((_radius + 1) *
+                        std::max(verticalTexelSpacing_, horizontalTexelSpacing_));
+}
+
 std::string GaussianBlurMonoFilter::_generateVertexShaderString(int radius,
                                                                 float sigma) {
   if (radius < 1 || sigma <= 0.0) {
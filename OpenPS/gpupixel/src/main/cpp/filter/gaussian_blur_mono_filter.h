@@ -26,6 +26,7 @@ class GPUPIXEL_API GaussianBlurMonoFilter : public Filter {
   virtual bool proceed(bool bUpdateTargets = true,
                        int64_t frameTime = 0) override;
   void setTexelSpacingMultiplier(float value);
+  virtual int getSampleFootprint(int width, int height) const override;
 
  protected:
   GaussianBlurMonoFilter(Type type = HORIZONTAL);
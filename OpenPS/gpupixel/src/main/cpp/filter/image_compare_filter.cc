@@ -9,10 +9,11 @@ const std::string kImageCompareFragmentShaderString = SHADER_STRING(
     uniform sampler2D inputImageTexture;
     uniform sampler2D originalImage;
     uniform float intensity;
+    uniform vec4 imageRegion;
 
     void main() {
       vec4 textureColor = texture2D(inputImageTexture, textureCoordinate);
-      vec4 originalColor = texture2D(originalImage, textureCoordinate);
+      vec4 originalColor = texture2D(originalImage, imageRegion.xy + textureCoordinate * imageRegion.zw);
       gl_FragColor = mix(textureColor, originalColor, intensity);
     }
 );
@@ -46,6 +47,7 @@ bool ImageCompareFilter::proceed(bool bUpdateTargets, int64_t frameTime) {
     CHECK_GL(glBindTexture(GL_TEXTURE_2D, originalImage->getFramebuffer()->getTexture()))
     _filterProgram->setUniformValue("originalImage", 3);
     _filterProgram->setUniformValue("intensity", intensity);
+    _filterProgram->setUniformValue("imageRegion", _imageRegion);
   }
   return Filter::proceed(bUpdateTargets, frameTime);
 }
@@ -6,6 +6,7 @@
  */
 
 #include "sharpen_filter.h"
+#include <cmath>
 
 USING_NS_GPUPIXEL
 
@@ -59,6 +60,10 @@ void SharpenFilter::setTexelSize(int textureWidth, int textureHeight) {
   _texelSizeY = 1.0f / textureHeight;
 }
 
+int SharpenFilter::getSampleFootprint(int width, int height) const {
+  return (int)std::ceil(std::max(_texelSizeX * width, _texelSizeY * height));
+}
+
 bool SharpenFilter::proceed(bool bUpdateTargets, int64_t frametime) {
   _filterProgram->setUniformValue("sharpness", _sharpness);
   _filterProgram->setUniformValue("texelSize", Vector2(_texelSizeX, _texelSizeY));
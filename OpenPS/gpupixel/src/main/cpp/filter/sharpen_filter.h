@@ -17,6 +17,7 @@ public:
   bool init();
   void setSharpness(float sharpness);
   void setTexelSize(int textureWidth, int textureHeight);
+  virtual int getSampleFootprint(int width, int height) const override;
   virtual bool proceed(bool bUpdateTargets = true,
                        int64_t frameTime = 0) override;
 
@@ -38,6 +38,9 @@ bool SingleComponentGaussianBlurFilter::init(int radius, float sigma) {
       SingleComponentGaussianBlurMonoFilter::VERTICAL, radius, sigma);
   _hBlurFilter->addTarget(_vBlurFilter);
   addFilter(_hBlurFilter);
+  // The horizontal pass only carries the blurred component to the vertical one
+  _hBlurFilter->setOutputTextureAttributes(
+      Framebuffer::singleChannelTextureAttributes());
 
   registerProperty("radius", 4, "", [this](int& radius) { setRadius(radius); });
 
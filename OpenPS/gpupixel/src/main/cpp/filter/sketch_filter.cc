@@ -71,6 +71,9 @@ bool SketchFilter::init() {
   _sketchFilter = _SketchFilter::create();
   _grayscaleFilter->addTarget(_sketchFilter);
   addFilter(_grayscaleFilter);
+  // The edge pass only reads the luminance through .r
+  _grayscaleFilter->setOutputTextureAttributes(
+      Framebuffer::singleChannelTextureAttributes());
 
   _edgeStrength = 1.0;
   registerProperty("edgeStrength", _edgeStrength,
@@ -75,6 +75,9 @@ bool SobelEdgeDetectionFilter::init() {
   _sobelEdgeDetectionFilter = _SobelEdgeDetectionFilter::create();
   _grayscaleFilter->addTarget(_sobelEdgeDetectionFilter);
   addFilter(_grayscaleFilter);
+  // The edge pass only reads the luminance through .r
+  _grayscaleFilter->setOutputTextureAttributes(
+      Framebuffer::singleChannelTextureAttributes());
 
   _edgeStrength = 1.0;
   registerProperty("edgeStrength", _edgeStrength,
@@ -0,0 +1,131 @@
+/*
+* LandmarkCache
+*/
+
+#include "landmark_cache.h"
+#include <cstdio>
+#include <cstring>
+#include "util.h"
+
+NS_GPUPIXEL_BEGIN
+
+namespace {
+constexpr uint32_t kFileMagic = 0x4d4c504f;  // "OPLM"
+constexpr uint32_t kFileVersion = 1;
+// Far above 5 faces of 111 points, guards against reading a corrupt file
+constexpr uint32_t kMaxValues = 4096;
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+inline uint64_t mix(uint64_t lane, uint64_t value) {
+  lane += value * kPrime2;
+  lane = (lane << 31) | (lane >> 33);
+  return lane * kPrime1;
+}
+}  // namespace
+
+uint64_t LandmarkCache::hashImage(const unsigned char* rgba, int width, int height) {
+  // Four independent lanes over 8 byte words keep this memory bound, well
+  // under the cost of a detection even for large photos
+  size_t size = (size_t) width * height * 4;
+  uint64_t lanes[4] = {kPrime1, kPrime2, (uint64_t) width, (uint64_t) height};
+  size_t offset = 0;
+  for (; offset + 32 <= size; offset += 32) {
+    for (int i = 0; i < 4; i++) {
+      uint64_t word;
+      memcpy(&word, rgba + offset + i * 8, 8);
+      lanes[i] = mix(lanes[i], word);
+    }
+  }
+  uint64_t hash = size;
+  for (int i = 0; i < 4; i++) {
+    hash = mix(hash, lanes[i]);
+  }
+  for (; offset < size; offset++) {
+    hash = mix(hash, rgba[offset]);
+  }
+  hash ^= hash >> 29;
+  return hash;
+}
+
+void LandmarkCache::setDirectory(const std::string& directory) {
+  this->directory = directory;
+  while (this->directory.size() > 1 && this->directory.back() == '/') {
+    this->directory.pop_back();
+  }
+}
+
+bool LandmarkCache::find(uint64_t hash, std::vector<float>& landmarks, std::vector<float>& rect) {
+  auto it = entries.find(hash);
+  if (it == entries.end()) {
+    Entry entry;
+    if (!readFile(hash, entry)) {
+      return false;
+    }
+    it = entries.emplace(hash, std::move(entry)).first;
+  }
+  landmarks = it->second.landmarks;
+  rect = it->second.rect;
+  return true;
+}
+
+void LandmarkCache::store(uint64_t hash, const std::vector<float>& landmarks, const std::vector<float>& rect) {
+  if (entries.count(hash)) {
+    return;
+  }
+  Entry& entry = entries[hash];
+  entry.landmarks = landmarks;
+  entry.rect = rect;
+  writeFile(hash, entry);
+}
+
+std::string LandmarkCache::filePath(uint64_t hash) const {
+  return Util::str_format("%s/landmarks_%016llx.bin", directory.c_str(),
+                          (unsigned long long) hash);
+}
+
+bool LandmarkCache::readFile(uint64_t hash, Entry& entry) const {
+  if (directory.empty()) {
+    return false;
+  }
+  FILE* file = fopen(filePath(hash).c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  uint32_t header[4];
+  bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+            header[0] == kFileMagic && header[1] == kFileVersion &&
+            header[2] <= kMaxValues && header[3] <= kMaxValues;
+  if (ok) {
+    entry.landmarks.resize(header[2]);
+    entry.rect.resize(header[3]);
+    ok = fread(entry.landmarks.data(), sizeof(float), header[2], file) == header[2] &&
+         fread(entry.rect.data(), sizeof(float), header[3], file) == header[3];
+  }
+  fclose(file);
+  return ok;
+}
+
+void LandmarkCache::writeFile(uint64_t hash, const Entry& entry) const {
+  if (directory.empty()) {
+    return;
+  }
+  std::string path = filePath(hash);
+  FILE* file = fopen(path.c_str(), "wb");
+  if (!file) {
+    Util::Log("LandmarkCache", "writeFile: cannot create %s", path.c_str());
+    return;
+  }
+  uint32_t header[4] = {kFileMagic, kFileVersion, (uint32_t) entry.landmarks.size(),
+                        (uint32_t) entry.rect.size()};
+  bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+            fwrite(entry.landmarks.data(), sizeof(float), entry.landmarks.size(), file) ==
+                entry.landmarks.size() &&
+            fwrite(entry.rect.data(), sizeof(float), entry.rect.size(), file) == entry.rect.size();
+  ok = fclose(file) == 0 && ok;
+  if (!ok) {
+    remove(path.c_str());
+  }
+}
+
+NS_GPUPIXEL_END
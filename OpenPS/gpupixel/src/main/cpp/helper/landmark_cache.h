@@ -0,0 +1,45 @@
+/*
+* LandmarkCache
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "gpupixel_macros.h"
+
+NS_GPUPIXEL_BEGIN
+
+/**
+ * Face detection results of still images keyed by a hash of the pixels, so an
+ * image seen before, in this session or a previous one, is never detected
+ * again. Entries are written as small files to the directory set with
+ * setDirectory, next to the images the undo/redo records refer to.
+ */
+class GPUPIXEL_API LandmarkCache {
+public:
+  static uint64_t hashImage(const unsigned char* rgba, int width, int height);
+
+  void setDirectory(const std::string& directory);
+
+  bool find(uint64_t hash, std::vector<float>& landmarks, std::vector<float>& rect);
+
+  void store(uint64_t hash, const std::vector<float>& landmarks, const std::vector<float>& rect);
+
+private:
+  struct Entry {
+    std::vector<float> landmarks;
+    std::vector<float> rect;
+  };
+
+  std::string filePath(uint64_t hash) const;
+  bool readFile(uint64_t hash, Entry& entry) const;
+  void writeFile(uint64_t hash, const Entry& entry) const;
+
+  std::map<uint64_t, Entry> entries;
+  std::string directory;
+};
+
+NS_GPUPIXEL_END
@@ -1,13 +1,36 @@
 #include "openps_helper.h"
 #include "util.h"
 #include "stb_image.h"
+#include "libyuv.h"
+#include "png_stream_writer.h"
+#include <cmath>
+#include <cstring>
+#include <condition_variable>
+
+namespace {
+// State shared between the render thread producing row bands of an export to
+// file and the worker encoding them
+struct FileExportJob {
+  gpupixel::PngStreamWriter writer;
+  std::mutex mutex;
+  std::condition_variable cv;
+  int pendingBands = 0;
+  bool failed = false;
+};
+}
 
 gpupixel::OpenPSHelper::OpenPSHelper() {
   targetView = std::make_shared<TargetView>();
   undoRedoHelper = UndoRedoHelper();
+#if defined(GPUPIXEL_ANDROID)
+  landmarkCache.setDirectory(Util::getExternalPathJni(""));
+#endif
 }
 
 gpupixel::OpenPSHelper::~OpenPSHelper() {
+  if (exportQueue) {
+    exportQueue->join();
+  }
   gpuSourceImage.reset();
   beautyFaceFilter.reset();
   lipstickFilter.reset();
@@ -29,13 +52,12 @@ void gpupixel::OpenPSHelper::initWithImage(int width, int height,
                                            int channelCount,
                                            const unsigned char *pixels,
                                            const char* filename) {
-  gpuSourceImage = SourceImage::create_from_memory(width, height, channelCount, pixels);
-  initialSourceImage = SourceImage::create_from_memory(width, height, channelCount, pixels);
+  uploadSourceImage(width, height, channelCount, pixels);
+  // Until the image is replaced the original is the source itself
+  initialSourceImage.reset();
   imageCompareFilter = ImageCompareFilter::create();
   imageCompareFilter->setFilterClassName("ImageCompareFilter");
-  imageCompareFilter->setOriginalImage(initialSourceImage);
-  imageWidth = width;
-  imageHeight = height;
+  imageCompareFilter->setOriginalImage(gpuSourceImage);
   if (filename) {
     currentImageFileName = filename;
     initialImageFileName = filename;
@@ -48,9 +70,8 @@ void gpupixel::OpenPSHelper::changeImage(int width, int height,
                                          const char* filename,
                                          const char* skinMaskFilename) {
   if (gpuSourceImage) {
-    gpuSourceImage->init(width, height, channelCount, pixels);
-    imageWidth = width;
-    imageHeight = height;
+    detachOriginalImage();
+    uploadSourceImage(width, height, channelCount, pixels);
     if (filename) {
       currentImageFileName = filename;
       if (skinMaskFilename) {
@@ -62,10 +83,17 @@ void gpupixel::OpenPSHelper::changeImage(int width, int height,
   }
 }
 
+// Undo and redo reload a saved edit. It is decoded at full size, not shrunk
+// to the preview on decode, because it becomes fullResPixels again and the
+// export renders from those. The proxy is scaled from them afterwards.
 void gpupixel::OpenPSHelper::changeImage(std::string filename) {
   if (!filename.empty()) {
     int width, height, channelCount;
+#if defined(GPUPIXEL_ANDROID)
     auto imageFileName = Util::getExternalPathJni(filename);
+#else
+    auto imageFileName = filename;
+#endif
     unsigned char* data = stbi_load(imageFileName.c_str(), &width, &height, &channelCount, 0);
     if (data != nullptr) {
       changeImage(width, height, channelCount, data);
@@ -76,6 +104,11 @@ void gpupixel::OpenPSHelper::changeImage(std::string filename) {
 
 void gpupixel::OpenPSHelper::onTargetViewSizeChanged(int width, int height) {
   targetView->onSizeChanged(width, height);
+  if (viewWidth != width || viewHeight != height) {
+    viewWidth = width;
+    viewHeight = height;
+    updateProxySourceImage();
+  }
 }
 
 void gpupixel::OpenPSHelper::getTargetViewInfo(float *info) {
@@ -96,6 +129,7 @@ void gpupixel::OpenPSHelper::buildRealRenderPipeline() {
   lipstickFilter->setFilterClassName("LipstickFilter");
   blusherFilter = BlusherFilter::create();
   blusherFilter->setFilterClassName("BlusherFilter");
+  lipstickFilter->addLayer(blusherFilter);
   faceReshapeFilter = FaceReshapeFilter::create();
   faceReshapeFilter->setFilterClassName("FaceReshapeFilter");
   contrastFilter = ContrastFilter::create();
@@ -106,27 +140,19 @@ void gpupixel::OpenPSHelper::buildRealRenderPipeline() {
   saturationFilter->setFilterClassName("SaturationFilter");
   sharpenFilter = SharpenFilter::create();
   sharpenFilter->setFilterClassName("SharpenFilter");
-  sharpenFilter->setTexelSize(imageWidth, imageHeight);
   brightnessFilter = BrightnessFilter::create();
   brightnessFilter->setFilterClassName("BrightnessFilter");
   customFilter = CustomFilter::create();
   customFilter->setFilterClassName("CustomFilter");
-  customFilter->setTexelSize(imageWidth, imageHeight);
+  applyAdjustmentFormats();
+  applyRenderResolution(proxyWidth, proxyHeight, (float) proxyWidth / imageWidth);
   targetRawDataOutput = TargetRawDataOutput::create();
-  gpuSourceImage->RegLandmarkCallback([=](std::vector<float> landmarks, std::vector<float> rect) {
-    if (lipstickFilter) {
-      lipstickFilter->SetFaceLandmarks(landmarks);
-    }
-    if (blusherFilter) {
-      blusherFilter->SetFaceLandmarks(landmarks);
-    }
-    if (faceReshapeFilter) {
-      faceReshapeFilter->SetFaceLandmarks(landmarks);
-    }
+  targetRawDataOutput->setSynchronousRead(true);
+  requestLandmarks([=](std::vector<float> landmarks, std::vector<float> rect) {
+    applyLandmarks(landmarks);
   });
   gpuSourceImage->addTarget(imageCompareFilter);
   imageCompareFilter->addTarget(targetView);
-  imageCompareFilter->addTarget(targetRawDataOutput);
   currentSkinMaskFileName = "skin_mask.png";
   addUndoRedoRecord();
 }
@@ -142,15 +168,16 @@ void gpupixel::OpenPSHelper::buildNoFaceRenderPipeline() {
     saturationFilter->setFilterClassName("SaturationFilter");
     sharpenFilter = SharpenFilter::create();
     sharpenFilter->setFilterClassName("SharpenFilter");
-    sharpenFilter->setTexelSize(imageWidth, imageHeight);
     brightnessFilter = BrightnessFilter::create();
     brightnessFilter->setFilterClassName("BrightnessFilter");
     customFilter = CustomFilter::create();
     customFilter->setFilterClassName("CustomFilter");
+    applyAdjustmentFormats();
+    applyRenderResolution(proxyWidth, proxyHeight, (float) proxyWidth / imageWidth);
     targetRawDataOutput = TargetRawDataOutput::create();
+    targetRawDataOutput->setSynchronousRead(true);
     gpuSourceImage->addTarget(imageCompareFilter);
     imageCompareFilter->addTarget(targetView);
-    imageCompareFilter->addTarget(targetRawDataOutput);
     addUndoRedoRecord();
   }
 }
@@ -165,10 +192,7 @@ void gpupixel::OpenPSHelper::requestRender(bool forceRenderImage) {
   if (gpuSourceImage) {
     if (forceRenderImage) {
       gpuSourceImage->Render();
-      return;
-    }
-
-    if (matrixUpdated && imageCompareFilter && imageCompareFilter->getFramebuffer()) {
+    } else if (matrixUpdated && imageCompareFilter && imageCompareFilter->getFramebuffer()) {
       imageCompareFilter->updateTargets(0, false);
       if (!targetView->updateMatrixState()) {
         gpuSourceImage->Render();
@@ -177,34 +201,87 @@ void gpupixel::OpenPSHelper::requestRender(bool forceRenderImage) {
     } else {
       gpuSourceImage->Render();
     }
+
+    if (isExportPending) {
+      renderFullResolution();
+      isExportPending = false;
+    }
   }
 }
 
 void gpupixel::OpenPSHelper::setLandmarkCallback(gpupixel::FaceDetectorCallback callback) {
-  gpuSourceImage->RegLandmarkCallback(callback);
+  requestLandmarks(callback);
 }
 
 void gpupixel::OpenPSHelper::manualDetectFace(const gpupixel::FaceDetectorCallback& callback) {
-  gpuSourceImage->RegLandmarkCallback([=](const std::vector<float>& landmarks, std::vector<float> rect) {
-    if (lipstickFilter) {
-      lipstickFilter->SetFaceLandmarks(landmarks);
-    }
-    if (blusherFilter) {
-      blusherFilter->SetFaceLandmarks(landmarks);
-    }
-    if (faceReshapeFilter) {
-      faceReshapeFilter->SetFaceLandmarks(landmarks);
-    }
+  requestLandmarks([=](const std::vector<float>& landmarks, std::vector<float> rect) {
+    applyLandmarks(landmarks);
     callback(landmarks, std::move(rect));
   });
 }
 
+void gpupixel::OpenPSHelper::requestLandmarks(gpupixel::FaceDetectorCallback callback) {
+  std::vector<float> landmarks;
+  std::vector<float> rect;
+  if (landmarkCache.find(currentImageHash, landmarks, rect)) {
+    callback(landmarks, rect);
+    return;
+  }
+  // Keyed by the image the detection runs on, even if it changes meanwhile
+  uint64_t hash = currentImageHash;
+  gpuSourceImage->RegLandmarkCallback([=](std::vector<float> landmarks, std::vector<float> rect) {
+    landmarkCache.store(hash, landmarks, rect);
+    callback(landmarks, rect);
+  });
+}
+
+void gpupixel::OpenPSHelper::applyLandmarks(const std::vector<float>& landmarks) {
+  if (lipstickFilter) {
+    lipstickFilter->SetFaceLandmarks(landmarks);
+  }
+  if (blusherFilter) {
+    blusherFilter->SetFaceLandmarks(landmarks);
+  }
+  if (faceReshapeFilter) {
+    faceReshapeFilter->SetFaceLandmarks(landmarks);
+  }
+}
+
 void gpupixel::OpenPSHelper::setRawOutputCallback(gpupixel::RawOutputCallback callback) {
   if (targetRawDataOutput) {
+    std::lock_guard<std::mutex> lock(pipelineMutex);
     targetRawDataOutput->setPixelsCallbck(callback);
+    isExportPending = true;
   }
 }
 
+void gpupixel::OpenPSHelper::exportToFile(const std::string& path, std::function<void(bool)> callback) {
+  if (!targetRawDataOutput) {
+    if (callback) {
+      callback(false);
+    }
+    return;
+  }
+  std::lock_guard<std::mutex> lock(pipelineMutex);
+  exportFilePath = path;
+  exportFileCallback = std::move(callback);
+  isExportPending = true;
+}
+
+void gpupixel::OpenPSHelper::setProxyEnabled(bool enabled) {
+  if (proxyEnabled == enabled) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(pipelineMutex);
+  proxyEnabled = enabled;
+  updateProxySourceImage();
+}
+
+void gpupixel::OpenPSHelper::setMaxTileSize(int size) {
+  std::lock_guard<std::mutex> lock(pipelineMutex);
+  maxTileSize = std::max(1, std::min(size, MAX_TILE_SIZE));
+}
+
 void gpupixel::OpenPSHelper::setSmoothLevel(float level, bool addRecord) {
   if (beautyFaceFilter) {
     std::lock_guard<std::mutex> lock(pipelineMutex);
@@ -346,13 +423,14 @@ void gpupixel::OpenPSHelper::setBrightnessLevel(float level, bool addRecord) {
 
 void gpupixel::OpenPSHelper::applyCustomFilter(int type, float level, bool addRecord) {
   if (customFilter) {
+    std::lock_guard<std::mutex> lock(pipelineMutex);
     customFilterLevel = level;
     customFilter->setType(type);
     customFilter->setIntensity(level);
     if (addRecord) {
       addUndoRedoRecord();
     }
-    refreshRenderPipeline();
+    isPipelineDirty = true;
   }
 }
 
@@ -552,10 +630,9 @@ void gpupixel::OpenPSHelper::refreshRenderPipeline() {
   bool changed = addOrRemoveFilter(smoothLevel != DEFAULT_LEVEL || whiteLevel != DEFAULT_LEVEL, beautyFaceFilter);
   needRebuild = needRebuild || changed;
 
-  changed = addOrRemoveFilter(lipstickLevel != DEFAULT_LEVEL, lipstickFilter);
-  needRebuild = needRebuild || changed;
-
-  changed = addOrRemoveFilter(blusherLevel != DEFAULT_LEVEL, blusherFilter);
+  // Blusher is a layer of the lipstick filter, both share one copy pass
+  changed = addOrRemoveFilter(lipstickLevel != DEFAULT_LEVEL || blusherLevel != DEFAULT_LEVEL,
+                              lipstickFilter);
   needRebuild = needRebuild || changed;
 
   changed = addOrRemoveFilter(eyeZoomLevel != DEFAULT_LEVEL || faceSlimLevel != DEFAULT_LEVEL, faceReshapeFilter);
@@ -607,7 +684,299 @@ void gpupixel::OpenPSHelper::refreshRenderPipeline() {
     pipelineLog += "imageCompareFilter(" + framebufferStr + ")";
     Util::Log("Pipeline", pipelineLog);
     imageCompareFilter->addTarget(targetView);
-    imageCompareFilter->addTarget(targetRawDataOutput);
+  }
+}
+
+void gpupixel::OpenPSHelper::uploadSourceImage(int width, int height,
+                                               int channelCount,
+                                               const unsigned char *pixels) {
+  imageWidth = width;
+  imageHeight = height;
+  size_t size = (size_t) width * height * 4;
+  if (fullResPixels.capacity() > size) {
+    // resize() keeps the capacity, a smaller image such as a crop would hold
+    // on to the previous image's allocation
+    std::vector<unsigned char>().swap(fullResPixels);
+  }
+  fullResPixels.resize(size);
+  if (channelCount == 3) {
+    // libyuv RGB24 is B,G,R in memory and expands to B,G,R,A, so byte order is kept
+    libyuv::RGB24ToARGB(pixels, width * 3, fullResPixels.data(), width * 4, width, height);
+  } else if (channelCount == 4) {
+    memcpy(fullResPixels.data(), pixels, fullResPixels.size());
+  } else {
+    Util::Log("OpenPSHelper", "uploadSourceImage: unsupported channel count %d", channelCount);
+    std::vector<unsigned char>().swap(fullResPixels);
+    return;
+  }
+  currentImageHash = LandmarkCache::hashImage(fullResPixels.data(), width, height);
+  // Undo and redo go back to images detected before, reuse their landmarks
+  std::vector<float> landmarks;
+  std::vector<float> rect;
+  if (landmarkCache.find(currentImageHash, landmarks, rect)) {
+    applyLandmarks(landmarks);
+  }
+  updateProxySourceImage();
+}
+
+void gpupixel::OpenPSHelper::updateProxySourceImage() {
+  if (fullResPixels.empty()) {
+    return;
+  }
+
+  float scale = 1;
+  if (proxyEnabled && viewWidth > 0 && viewHeight > 0) {
+    scale = std::min((float) viewWidth / imageWidth, (float) viewHeight / imageHeight);
+  }
+  // Images beyond the texture limit can only be previewed downscaled, even
+  // with the proxy disabled. Export renders them in tiles.
+  int maxTextureSize = Framebuffer::getMaxTextureSize();
+  if (maxTextureSize > 0) {
+    scale = std::min(scale, std::min((float) maxTextureSize / imageWidth,
+                                     (float) maxTextureSize / imageHeight));
+  }
+  proxyWidth = imageWidth;
+  proxyHeight = imageHeight;
+  if (scale < 1) {
+    proxyWidth = std::max(1, (int) std::round(imageWidth * scale));
+    proxyHeight = std::max(1, (int) std::round(imageHeight * scale));
+  }
+
+  std::vector<unsigned char> proxyPixels;
+  const unsigned char* pixels = fullResPixels.data();
+  if (isProxyActive()) {
+    proxyPixels = scaleFullResPixels(proxyWidth, proxyHeight);
+    pixels = proxyPixels.data();
+  }
+  if (gpuSourceImage) {
+    gpuSourceImage->init(proxyWidth, proxyHeight, 4, pixels);
+  } else {
+    gpuSourceImage = SourceImage::create_from_memory(proxyWidth, proxyHeight, 4, pixels);
+  }
+  applyRenderResolution(proxyWidth, proxyHeight, (float) proxyWidth / imageWidth);
+}
+
+void gpupixel::OpenPSHelper::detachOriginalImage() {
+  if (initialSourceImage || !imageCompareFilter || fullResPixels.empty()) {
+    return;
+  }
+  // fullResPixels still hold the original here. It is only ever displayed,
+  // keep it at preview size.
+  if (isProxyActive()) {
+    auto proxyPixels = scaleFullResPixels(proxyWidth, proxyHeight);
+    initialSourceImage = SourceImage::create_from_memory(proxyWidth, proxyHeight, 4, proxyPixels.data());
+  } else {
+    initialSourceImage = SourceImage::create_from_memory(imageWidth, imageHeight, 4, fullResPixels.data());
+  }
+  imageCompareFilter->setOriginalImage(initialSourceImage);
+}
+
+std::vector<unsigned char> gpupixel::OpenPSHelper::scaleFullResPixels(int width, int height) const {
+  std::vector<unsigned char> pixels((size_t) width * height * 4);
+  libyuv::ARGBScale(fullResPixels.data(), imageWidth * 4, imageWidth, imageHeight,
+                    pixels.data(), width * 4, width, height,
+                    libyuv::kFilterBox);
+  return pixels;
+}
+
+bool gpupixel::OpenPSHelper::isProxyActive() const {
+  return proxyWidth != imageWidth || proxyHeight != imageHeight;
+}
+
+void gpupixel::OpenPSHelper::applyRenderResolution(int width, int height, float pixelScale) {
+  // Blur spacing is defined in full resolution pixels, shrink it for the proxy
+  // so preview and export cover the same area of the image
+  if (beautyFaceFilter) {
+    beautyFaceFilter->setTexelSpacingMultiplier(BEAUTY_TEXEL_SPACING * pixelScale);
+  }
+  // Likewise the texel offsets stay one full resolution pixel, for a tile
+  // (pixelScale 1) that is one pixel of the tile
+  int texelWidth = (int) std::lround(width / pixelScale);
+  int texelHeight = (int) std::lround(height / pixelScale);
+  if (sharpenFilter) {
+    sharpenFilter->setTexelSize(texelWidth, texelHeight);
+  }
+  if (customFilter) {
+    customFilter->setTexelSize(texelWidth, texelHeight);
+  }
+}
+
+void gpupixel::OpenPSHelper::applyAdjustmentFormats() {
+  // Tone adjustments stretch and compress ranges, chaining them through 8 bit
+  // intermediates shows up as banding in gradients. They are never last in the
+  // chain, imageCompareFilter always renders the 8 bit result.
+  TextureAttributes attributes = Framebuffer::halfFloatTextureAttributes();
+  for (auto filter : std::vector<std::shared_ptr<Filter>>{contrastFilter, exposureFilter, saturationFilter, brightnessFilter}) {
+    if (filter) {
+      filter->setOutputTextureAttributes(attributes);
+    }
+  }
+}
+
+void gpupixel::OpenPSHelper::setImageRegion(const Vector4& region) {
+  for (auto& filter : filterList) {
+    filter->setImageRegion(region);
+  }
+  imageCompareFilter->setImageRegion(region);
+}
+
+void gpupixel::OpenPSHelper::renderFullResolution() {
+  if (!targetRawDataOutput || !imageCompareFilter || fullResPixels.empty()) {
+    return;
+  }
+
+  std::shared_ptr<FileExportJob> job;
+  std::function<void(bool)> fileCallback;
+  if (!exportFilePath.empty()) {
+    job = std::make_shared<FileExportJob>();
+    fileCallback = std::move(exportFileCallback);
+    exportFileCallback = nullptr;
+    bool opened = job->writer.open(exportFilePath, imageWidth, imageHeight);
+    exportFilePath = "";
+    if (!opened) {
+      if (fileCallback) {
+        fileCallback(false);
+      }
+      return;
+    }
+    if (!exportQueue) {
+      exportQueue = std::make_unique<DispatchQueue>(DispatchQueue::Serial);
+    }
+  }
+
+  int tileSize = maxTileSize;
+  int maxTextureSize = Framebuffer::getMaxTextureSize();
+  if (maxTextureSize > 0) {
+    tileSize = std::min(tileSize, maxTextureSize);
+  }
+  // A file export always takes the tiled path, which reads back in row bands
+  bool streaming = job != nullptr;
+  bool tiled = streaming || imageWidth > tileSize || imageHeight > tileSize;
+  int tileWidth = std::min(imageWidth, tileSize);
+  int tileHeight = std::min(imageHeight, tileSize);
+
+  // Each tile carries enough border for the widest sampling chain, only its
+  // core is stitched into the output
+  int overlap = 0;
+  if (tiled) {
+    // Footprints follow the current texel spacing, which the preview scales
+    // down for the proxy
+    applyRenderResolution(imageWidth, imageHeight, 1);
+    for (auto& filter : filterList) {
+      overlap += filter->getSampleFootprint(imageWidth, imageHeight);
+    }
+    if (overlap > tileSize / 4) {
+      Util::Log("OpenPSHelper", "renderFullResolution: clamp tile overlap %d to %d", overlap, tileSize / 4);
+      overlap = tileSize / 4;
+    }
+  }
+  // A row of tiles narrower than the image is buffered until it completes,
+  // keep it one band tall while streaming
+  if (streaming && tileWidth < imageWidth) {
+    tileHeight = std::min(imageHeight, TargetRawDataOutput::kStreamBandRows + 2 * overlap);
+  }
+
+  // Landmarks and reshape strengths are normalized, only the pipeline head
+  // and the pixel based parameters have to follow the full resolution source
+  std::shared_ptr<SourceImage> exportSourceImage = gpuSourceImage;
+  std::map<std::shared_ptr<Target>, int> headTargets;
+  if (tiled || isProxyActive()) {
+    exportSourceImage = std::make_shared<SourceImage>();
+    headTargets = gpuSourceImage->getTargets();
+    gpuSourceImage->removeAllTargets();
+    for (auto& it : headTargets) {
+      exportSourceImage->addTarget(it.first, it.second);
+    }
+    applyRenderResolution(tileWidth, tileHeight, 1);
+  }
+
+  imageCompareFilter->removeTarget(targetView);
+  imageCompareFilter->addTarget(targetRawDataOutput);
+
+  if (!tiled) {
+    if (exportSourceImage != gpuSourceImage) {
+      exportSourceImage->init(imageWidth, imageHeight, 4, fullResPixels.data());
+    }
+    exportSourceImage->Render();
+  } else {
+    // Tiles keep one size so the framebuffer cache is reused across the grid
+    int stepX = imageWidth > tileWidth ? tileWidth - 2 * overlap : imageWidth;
+    int stepY = imageHeight > tileHeight ? tileHeight - 2 * overlap : imageHeight;
+    // Full width tiles are contiguous rows of the source and need no copy
+    std::vector<unsigned char> tilePixels;
+    if (tileWidth != imageWidth) {
+      tilePixels.resize((size_t) tileWidth * tileHeight * 4);
+    }
+
+    if (streaming) {
+      // Finished bands are moved to exportQueue and encoded there. The
+      // render thread waits while MAX_PENDING_EXPORT_BANDS are queued, so
+      // memory stays bounded when encoding is slower than readback.
+      int maxPendingBands = MAX_PENDING_EXPORT_BANDS;
+      DispatchQueue* queue = exportQueue.get();
+      targetRawDataOutput->beginTiledOutput(imageWidth, imageHeight,
+          [job, queue, maxPendingBands](std::vector<uint8_t> data, int width, int y, int rows) {
+        {
+          std::unique_lock<std::mutex> lock(job->mutex);
+          job->cv.wait(lock, [&] { return job->pendingBands < maxPendingBands; });
+          job->pendingBands++;
+        }
+        auto band = std::make_shared<std::vector<uint8_t>>(std::move(data));
+        queue->add([job, band, rows] {
+          bool ok = job->writer.writeRows(band->data(), rows);
+          std::lock_guard<std::mutex> lock(job->mutex);
+          job->failed = job->failed || !ok;
+          job->pendingBands--;
+          job->cv.notify_all();
+        });
+      });
+    } else {
+      targetRawDataOutput->beginTiledOutput(imageWidth, imageHeight);
+    }
+    for (int y = 0; y < imageHeight; y += stepY) {
+      for (int x = 0; x < imageWidth; x += stepX) {
+        int sourceX = std::max(0, std::min(x - overlap, imageWidth - tileWidth));
+        int sourceY = std::max(0, std::min(y - overlap, imageHeight - tileHeight));
+        const unsigned char* tileSource = fullResPixels.data() + (size_t) sourceY * imageWidth * 4;
+        if (!tilePixels.empty()) {
+          for (int row = 0; row < tileHeight; ++row) {
+            memcpy(tilePixels.data() + (size_t) row * tileWidth * 4,
+                   fullResPixels.data() + ((size_t) (sourceY + row) * imageWidth + sourceX) * 4,
+                   (size_t) tileWidth * 4);
+          }
+          tileSource = tilePixels.data();
+        }
+        exportSourceImage->init(tileWidth, tileHeight, 4, tileSource);
+        setImageRegion(Vector4((float) sourceX / imageWidth, (float) sourceY / imageHeight,
+                               (float) tileWidth / imageWidth, (float) tileHeight / imageHeight));
+        targetRawDataOutput->setOutputTile(x, y, x - sourceX, y - sourceY,
+                                           std::min(stepX, imageWidth - x),
+                                           std::min(stepY, imageHeight - y));
+        exportSourceImage->Render();
+      }
+    }
+    setImageRegion(Vector4(0, 0, 1, 1));
+    targetRawDataOutput->endTiledOutput();
+
+    if (streaming) {
+      exportQueue->add([job, fileCallback] {
+        bool ok = !job->failed && job->writer.close();
+        if (fileCallback) {
+          fileCallback(ok);
+        }
+      });
+    }
+  }
+
+  imageCompareFilter->removeTarget(targetRawDataOutput);
+  imageCompareFilter->addTarget(targetView);
+
+  if (exportSourceImage != gpuSourceImage) {
+    exportSourceImage->removeAllTargets();
+    for (auto& it : headTargets) {
+      gpuSourceImage->addTarget(it.first, it.second);
+    }
+    applyRenderResolution(proxyWidth, proxyHeight, (float) proxyWidth / imageWidth);
   }
 }
 
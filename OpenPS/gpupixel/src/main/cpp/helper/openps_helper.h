@@ -12,6 +12,9 @@
 #include "undo_redo_helper.h"
 #include "abstract_record.h"
 #include "openps_record.h"
+#include "dispatch_queue.h"
+#include "landmark_cache.h"
+#include <functional>
 #include <mutex>
 
 NS_GPUPIXEL_BEGIN
@@ -50,8 +53,31 @@ public:
 
   void manualDetectFace(const FaceDetectorCallback& callback);
 
+  /**
+   * The callback is fired by a one-shot full resolution render pass that runs
+   * after the next preview frame, so the result never has proxy resolution.
+   */
   void setRawOutputCallback(RawOutputCallback callback);
 
+  /**
+   * Like setRawOutputCallback, but the full resolution result is encoded to a
+   * PNG file at path band by band on a worker thread instead of being returned
+   * as one RGBA buffer. callback runs on that worker thread with the outcome.
+   */
+  void exportToFile(const std::string& path, std::function<void(bool)> callback);
+
+  /**
+   * When enabled, the preview pipeline runs on a copy of the image downscaled
+   * to the target view size. Disabled, it runs on the full resolution image.
+   */
+  void setProxyEnabled(bool enabled);
+
+  /**
+   * Caps the size of a full resolution render tile below MAX_TILE_SIZE.
+   * Smaller tiles need less GPU memory per pass but render more borders.
+   */
+  void setMaxTileSize(int size);
+
   void setSmoothLevel(float level, bool addRecord = false);
 
   void setWhiteLevel(float level, bool addRecord = false);
@@ -133,8 +159,38 @@ private:
 
   int imageWidth = 0;
   int imageHeight = 0;
+  int proxyWidth = 0;
+  int proxyHeight = 0;
+  int viewWidth = 0;
+  int viewHeight = 0;
+  bool proxyEnabled = true;
+  bool isExportPending = false;
+  /**
+   * Full resolution RGBA copy of the current image, 4 bytes per pixel for as
+   * long as the image is open: about 48 MB at 12 MP and 190 MB at 48 MP.
+   * Once the image is larger than the view the GPU only holds the proxy, so
+   * this copy is the only full resolution source left. It feeds proxy
+   * rebuilds when the view size changes, the compare original when the image
+   * is first replaced, and every export tile. The file the app saves the
+   * image to is written asynchronously and may not exist yet when those run,
+   * and decoding a 48 MP PNG for each of them would take seconds.
+   */
+  std::vector<unsigned char> fullResPixels;
+  // Texel spacing of the beauty blur, in full resolution pixels
+  static constexpr float BEAUTY_TEXEL_SPACING = 4;
+  // Upper bound of an export tile, also capped by GL_MAX_TEXTURE_SIZE
+  static constexpr int MAX_TILE_SIZE = 4096;
+  int maxTileSize = MAX_TILE_SIZE;
+  // Row bands an export to file may queue for encoding before rendering waits
+  static constexpr int MAX_PENDING_EXPORT_BANDS = 4;
+  std::string exportFilePath = "";
+  std::function<void(bool)> exportFileCallback;
+  std::unique_ptr<DispatchQueue> exportQueue;
   bool matrixUpdated = false;
   std::string initialImageFileName = "";
+  // Content hash of fullResPixels, the key of landmarkCache
+  uint64_t currentImageHash = 0;
+  LandmarkCache landmarkCache;
 
   std::mutex pipelineMutex;
   bool isPipelineDirty = false;
@@ -143,6 +199,37 @@ private:
   void addUndoRedoRecord();
   void setLevels(OpenPSRecord record);
   void refreshRenderPipeline();
+  void uploadSourceImage(int width, int height, int channelCount, const unsigned char* pixels);
+  void updateProxySourceImage();
+  /**
+   * The compare original shares gpuSourceImage's texture until the image is
+   * first replaced, this gives it a texture of its own before that happens
+   */
+  void detachOriginalImage();
+  std::vector<unsigned char> scaleFullResPixels(int width, int height) const;
+  bool isProxyActive() const;
+  /**
+   * Scales the pixel based filter parameters for a pass rendered at width x height,
+   * where pixelScale is the size of a full resolution pixel in rendered pixels
+   */
+  void applyRenderResolution(int width, int height, float pixelScale);
+  /**
+   * Gives the tone adjustment filters half float outputs where renderable
+   */
+  void applyAdjustmentFormats();
+  void setImageRegion(const Vector4& region);
+  /**
+   * Runs callback with the landmarks of the current image, from landmarkCache
+   * right away or from a detection on the next render
+   */
+  void requestLandmarks(FaceDetectorCallback callback);
+  void applyLandmarks(const std::vector<float>& landmarks);
+  /**
+   * Renders the full resolution image into targetRawDataOutput, in overlapping
+   * tiles if it exceeds MAX_TILE_SIZE. With exportFilePath set, the rows are
+   * streamed to that file instead.
+   */
+  void renderFullResolution();
   /**
    * @return needRebuild
    */
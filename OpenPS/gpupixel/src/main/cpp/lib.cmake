@@ -209,6 +209,7 @@ IF(${CURRENT_OS} STREQUAL "linux" OR ${CURRENT_OS} STREQUAL "wasm")
 						${PROJECT_NAME}  
 						GL
 						glfw
+						z
 						vnn_core
 						vnn_kit
 						vnn_face)
@@ -232,6 +233,7 @@ ELSEIF(${CURRENT_OS} STREQUAL "macos")
 						-framework vnn_kit_osx \
 						-framework vnn_core_osx \
 						-framework vnn_face_osx"
+		z
 	)
 ELSEIF(${CURRENT_OS} STREQUAL "ios")
 	TARGET_LINK_LIBRARIES(
@@ -245,6 +247,7 @@ ELSEIF(${CURRENT_OS} STREQUAL "ios")
 					-framework vnn_kit_ios \
 					-framework vnn_core_ios \
 					-framework vnn_face_ios"
+	z
 	)
 ELSEIF(${CURRENT_OS} STREQUAL "android")
 	TARGET_LINK_LIBRARIES(
@@ -254,6 +257,7 @@ ELSEIF(${CURRENT_OS} STREQUAL "android")
 					GLESv3
 					EGL
 					jnigraphics
+					z
 					vnn_core
 					vnn_kit
 					vnn_face)
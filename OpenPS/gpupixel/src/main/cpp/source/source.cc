@@ -6,6 +6,7 @@
  */
 
 #include "source.h"
+#include "filter.h"
 #include "gpupixel_context.h"
 #include "util.h"
 
@@ -15,6 +16,26 @@
 
 NS_GPUPIXEL_BEGIN
 
+namespace {
+void drawScaled(GLProgram* program,
+                std::shared_ptr<Framebuffer> input,
+                std::shared_ptr<Framebuffer> output) {
+  GPUPixelContext::getInstance()->setActiveShaderProgram(program);
+  output->active();
+  CHECK_GL(glActiveTexture(GL_TEXTURE0));
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D, input->getTexture()));
+  program->setUniformValue("inputImageTexture", 0);
+  program->setUniformValue("mvpMatrix", Matrix4::IDENTITY);
+  GLuint position = program->getAttribLocation("position");
+  GLuint texCoord = program->getAttribLocation("inputTextureCoordinate");
+  CHECK_GL(glEnableVertexAttribArray(position));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(position);
+  CHECK_GL(glEnableVertexAttribArray(texCoord));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(texCoord, NoRotation);
+  CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+}
+}  // namespace
+
 Source::Source()
     : _framebuffer(0),
       _outputRotation(RotationMode::NoRotation),
@@ -22,6 +43,10 @@ Source::Source()
 
 Source::~Source() {
   removeAllTargets();
+  if (_detectionProgram) {
+    delete _detectionProgram;
+    _detectionProgram = nullptr;
+  }
 }
 
 std::shared_ptr<Source> Source::addTarget(std::shared_ptr<Target> target) {
@@ -148,6 +173,54 @@ int Source::RegLandmarkCallback(FaceDetectorCallback callback) {
   return _face_detector->RegCallback(callback);
 }
 
+bool Source::readDetectionImage(int maxSize,
+                                std::vector<uint8_t>& pixels,
+                                int& width,
+                                int& height) {
+  if (!_framebuffer) {
+    return false;
+  }
+  int sourceWidth = _framebuffer->getWidth();
+  int sourceHeight = _framebuffer->getHeight();
+  float scale = std::min(1.0f, (float)maxSize / std::max(sourceWidth, sourceHeight));
+  width = std::max(1, (int)(sourceWidth * scale));
+  height = std::max(1, (int)(sourceHeight * scale));
+
+  auto cache = GPUPixelContext::getInstance()->getFramebufferCache();
+  if (!_detectionProgram) {
+    _detectionProgram = GLProgram::createByShaderString(kDefaultVertexShader,
+                                                        kDefaultFragmentShader);
+  }
+  std::vector<std::shared_ptr<Framebuffer>> fetched;
+
+  // Halve until a single bilinear step reaches the target size, so every
+  // step averages 2x2 texels instead of skipping most of them
+  std::shared_ptr<Framebuffer> input = _framebuffer;
+  while (input->getWidth() > width * 2 || input->getHeight() > height * 2) {
+    auto output = cache->fetchFramebuffer(std::max(input->getWidth() / 2, width),
+                                          std::max(input->getHeight() / 2, height));
+    drawScaled(_detectionProgram, input, output);
+    fetched.push_back(output);
+    input = output;
+  }
+
+  auto output = cache->fetchFramebuffer(width, height);
+  drawScaled(_detectionProgram, input, output);
+  fetched.push_back(output);
+
+  output->active();
+  CHECK_GL(glPixelStorei(GL_PACK_ALIGNMENT, 4));
+  pixels.resize(width * height * 4);
+  CHECK_GL(glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE,
+                        pixels.data()));
+  output->inactive();
+
+  for (auto& framebuffer : fetched) {
+    cache->returnFramebuffer(framebuffer);
+  }
+  return true;
+}
+
 int Source::getRotatedFramebufferHeight() const {
   if (_framebuffer) {
     if (rotationSwapsSize(_outputRotation)) {
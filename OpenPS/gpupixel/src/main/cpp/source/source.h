@@ -18,6 +18,7 @@
 
 NS_GPUPIXEL_BEGIN
 class GPUPIXEL_API Filter;
+class GPUPIXEL_API GLProgram;
 
 class GPUPIXEL_API Source {
  public:
@@ -57,11 +58,21 @@ class GPUPIXEL_API Source {
       int height = 0);
   int RegLandmarkCallback(FaceDetectorCallback callback);
  protected:
+  // Scales the framebuffer down on the GPU to at most maxSize on the long side
+  // and reads it back as RGBA for the face detector. Landmarks are
+  // normalized, so they need no mapping back.
+  bool readDetectionImage(int maxSize,
+                          std::vector<uint8_t>& pixels,
+                          int& width,
+                          int& height);
+
   std::shared_ptr<Framebuffer> _framebuffer;
   RotationMode _outputRotation;
   std::map<std::shared_ptr<Target>, int> _targets;
   float _framebufferScale;
   std::shared_ptr<FaceDetector> _face_detector;
+  // downscales for readDetectionImage(), created on first use
+  GLProgram* _detectionProgram = nullptr;
 };
 
 NS_GPUPIXEL_END
@@ -50,9 +50,9 @@ void SourceCamera::setFrameData(
             width, height, true);
   }
   if(_face_detector) {
-      _face_detector->Detect(static_cast<const uint8_t *>(pixels), width, height,
-                             GPUPIXEL_MODE_FMT_VIDEO,
-                             GPUPIXEL_FRAME_TYPE_RGBA8888);
+      _face_detector->DetectAsync(static_cast<const uint8_t *>(pixels), width, height,
+                                  width * 4, Util::nowTimeMs());
+      _face_detector->DispatchLatestResult();
   }
   this->setFramebuffer(_framebuffer, outputRotation);
 
@@ -6,6 +6,7 @@
  */
 
 #include "source_image.h"
+#include <future>
 #include "gpupixel_context.h"
 #include "util.h"
 
@@ -28,21 +29,66 @@ std::shared_ptr<SourceImage> SourceImage::create_from_memory(int width,
     return sourceImage;
 }
 
-std::shared_ptr<SourceImage> SourceImage::create(const std::string name) {
-    int width, height, channel_count;
-    unsigned char *data = stbi_load(name.c_str(), &width, &height, &channel_count, 0);
+std::shared_ptr<SourceImage> SourceImage::create(const std::string name, int desiredChannels) {
+    return create_from_pixels(decode(name, desiredChannels));
+}
+
+std::vector<std::shared_ptr<SourceImage>> SourceImage::create_all(
+        const std::vector<std::string>& names) {
+    // Only the uploads need the GL thread
+    std::vector<std::future<Pixels>> decodes;
+    for (const auto& name : names) {
+        decodes.push_back(std::async(std::launch::async, [name] { return decode(name); }));
+    }
+    std::vector<std::shared_ptr<SourceImage>> images;
+    for (auto& pixels : decodes) {
+        images.push_back(create_from_pixels(pixels.get()));
+    }
+    return images;
+}
+
+SourceImage::Pixels SourceImage::decode(const std::string& name, int desiredChannels) {
+    Pixels pixels;
+    unsigned char *data = stbi_load(name.c_str(), &pixels.width, &pixels.height,
+                                    &pixels.channelCount, desiredChannels);
 //   todo(logo info)
     if(data == nullptr) {
         Util::Log("SourceImage", "SourceImage: input data in null! file name: %s", name.c_str());
+        return Pixels();
+    }
+    if (desiredChannels > 0) {
+        pixels.channelCount = desiredChannels;
+    }
+    pixels.data = std::shared_ptr<unsigned char>(data, stbi_image_free);
+    return pixels;
+}
+
+std::shared_ptr<SourceImage> SourceImage::create_from_pixels(const Pixels& pixels) {
+    if (!pixels.data) {
         return nullptr;
     }
-    auto image = SourceImage::create_from_memory(width, height, channel_count, data);
-    stbi_image_free(data);
-    return image;
+    return create_from_memory(pixels.width, pixels.height, pixels.channelCount,
+                              pixels.data.get());
 }
 
 void SourceImage::init(int width, int height, int channel_count, const unsigned char* pixels) {
-    this->setFramebuffer(0);
+    GLenum format;
+    if (channel_count == 1) {
+        // Sampled as (l, l, l, 1), a quarter of the RGBA footprint
+        format = GL_LUMINANCE;
+    } else if (channel_count == 3) {
+        // Uploaded as is, GL adds the alpha. No RGBA copy on the CPU.
+        format = GL_RGB;
+    } else if (channel_count == 4) {
+        format = GL_RGBA;
+    } else {
+        Util::Log("SourceImage", "init: unsupported channel count %d", channel_count);
+        return;
+    }
+    // Same size and layout as the current texture, e.g. a proxy rebuilt at the
+    // same view size, overwrites it instead of allocating a new one
+    bool reuse = _framebuffer && _framebuffer->getWidth() == width &&
+                 _framebuffer->getHeight() == height && _channelCount == channel_count;
     if (!_framebuffer || (_framebuffer->getWidth() != width ||
                             _framebuffer->getHeight() != height)) {
         _framebuffer =
@@ -50,42 +96,33 @@ void SourceImage::init(int width, int height, int channel_count, const unsigned
                         width, height, true);
     }
     this->setFramebuffer(_framebuffer);
+    _channelCount = channel_count;
     CHECK_GL(glBindTexture(GL_TEXTURE_2D, this->getFramebuffer()->getTexture()));
+    // RGB and luminance rows are rarely 4 byte aligned
     CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
-  if(channel_count == 3) {
-    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB,
-                          GL_UNSIGNED_BYTE, pixels));
-   
-    int rgba_size = width * height * 4;
-    uint8_t* rgba = new uint8_t[rgba_size];
-    
-    for (int i = 0; i < width * height; i++) {
-        rgba[i * 4 + 0] = pixels[i * 3 + 0];  // Red
-        rgba[i * 4 + 1] = pixels[i * 3 + 1];  // Green
-        rgba[i * 4 + 2] = pixels[i * 3 + 2];  // Blue
-        rgba[i * 4 + 3] = 255;              // Alpha (fully opaque)
+    if (reuse) {
+        CHECK_GL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format,
+                                 GL_UNSIGNED_BYTE, pixels));
+    } else {
+        CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format,
+                              GL_UNSIGNED_BYTE, pixels));
     }
-    
-    image_bytes.assign(rgba, rgba + width * height *4);
-    
-    delete[] rgba;
-  } else if(channel_count == 4) {
-    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA,
-                          GL_UNSIGNED_BYTE, pixels));
-    image_bytes.assign(pixels, pixels + width * height *4);
-  }
-  CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
+    CHECK_GL(glBindTexture(GL_TEXTURE_2D, 0));
 }
 
 void SourceImage::Render() {
-  GPUPIXEL_FRAME_TYPE type;
+  // A still image is detected once and the caller waits for its landmarks,
+  // so this stays synchronous unlike the video sources. The detector gets a
+  // copy scaled down on the GPU, no full resolution pixels stay on the CPU.
   if(_face_detector) {
     Util::Log("MitakeRan", "FaceDetector Detect");
-    _face_detector->Detect(image_bytes.data(),
-                           _framebuffer->getWidth(),
-                           _framebuffer->getHeight(),
-                           GPUPIXEL_MODE_FMT_PICTURE,
-                           GPUPIXEL_FRAME_TYPE_RGBA8888);
+    std::vector<uint8_t> pixels;
+    int width, height;
+    if (readDetectionImage(kDetectionSize, pixels, width, height)) {
+      _face_detector->Detect(pixels.data(), width, height,
+                             GPUPIXEL_MODE_FMT_PICTURE,
+                             GPUPIXEL_FRAME_TYPE_RGBA8888);
+    }
     _face_detector.reset();
   }
   
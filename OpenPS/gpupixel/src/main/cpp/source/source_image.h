@@ -8,6 +8,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "source.h"
 
@@ -21,19 +22,43 @@ class GPUPIXEL_API SourceImage : public Source {
               int height,
               int channel_count,
               const unsigned char* pixels);
+  // desiredChannels forces the decoded channel count as stbi_load does, 1
+  // uploads a luminance texture for masks
   static std::shared_ptr<SourceImage> create(
-      const std::string name);
+      const std::string name, int desiredChannels = 0);
 
   static std::shared_ptr<SourceImage> create_from_memory(int width,
                                             int height,
                                             int channel_count,
                                             const unsigned char* pixels);
+
+  // Pixels of an image file, freed with stbi_image_free
+  struct Pixels {
+    int width = 0;
+    int height = 0;
+    int channelCount = 0;
+    std::shared_ptr<unsigned char> data;
+  };
+  // Decodes without touching GL, so it can run on a worker thread while the
+  // GL thread does something else. name must already be a full path. Always
+  // full size: the callers load lookup tables and masks, which must not be
+  // resampled, and stb_image has no scaled JPEG decode to offer anyway.
+  static Pixels decode(const std::string& name, int desiredChannels = 0);
+  static std::shared_ptr<SourceImage> create_from_pixels(const Pixels& pixels);
+  // Like create for each name, but the files are decoded in parallel. Entries
+  // of files that fail to load are null.
+  static std::vector<std::shared_ptr<SourceImage>> create_all(
+      const std::vector<std::string>& names);
   void Render();
  private:
 #if defined(GPUPIXEL_ANDROID)
     static std::shared_ptr<SourceImage> createImageForAndroid(std::string name);
 #endif
-  std::vector<unsigned char> image_bytes;
+  // Channels of the pixels last uploaded into the texture
+  int _channelCount = 0;
+  // Long side of the image handed to the face detector. Larger than the
+  // video size, faces in group photos can be small.
+  static constexpr int kDetectionSize = 1280;
 };
 
 NS_GPUPIXEL_END
@@ -124,7 +124,10 @@ void SourceRawDataInput::uploadBytes(const uint8_t* pixels,
                                      int64_t ts) {
   GPUPixelContext::getInstance()->runSync([=] {
     if(_face_detector) {
-      _face_detector->Detect(pixels, width, height, GPUPIXEL_MODE_FMT_VIDEO,GPUPIXEL_FRAME_TYPE_RGBA8888);
+      // Detection runs on the detector's worker, the frame is rendered with
+      // the newest landmarks that are ready
+      _face_detector->DetectAsync(pixels, width, height, stride * 4, ts);
+      _face_detector->DispatchLatestResult();
     }
     genTextureWithRGBA(pixels, width, height, stride, ts); 
   });
@@ -145,7 +148,9 @@ void SourceRawDataInput::uploadBytes(int width,
                                      int64_t ts) {
   GPUPixelContext::getInstance()->runSync([=] {
     if(_face_detector) {
-      _face_detector->Detect(dataY, width, height, GPUPIXEL_MODE_FMT_VIDEO, GPUPIXEL_FRAME_TYPE_YUVI420);
+      _face_detector->DetectAsync(width, height, dataY, strideY, dataU, strideU,
+                                  dataV, strideV, ts);
+      _face_detector->DispatchLatestResult();
     }
 
     genTextureWithI420(width, height, dataY, strideY, dataU, strideU, dataV,
@@ -174,20 +179,12 @@ int SourceRawDataInput::genTextureWithI420(int width,
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   this->getFramebuffer()->active();
 
-  GLfloat imageVertices[]{
-      -1.0, -1.0,  // left down
-      1.0,  -1.0,  // right down
-      -1.0, 1.0,   // left up
-      1.0,  1.0    // right up
-  };
-
   CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
   CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-                                 _getTexureCoordinate(_rotation)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      _filterTexCoordAttribute, _rotation);
 
   const uint8_t* pixels[3] = {dataY, dataU, dataV};
   const int widths[3] = {width, width / 2, width / 2};
@@ -195,9 +192,8 @@ int SourceRawDataInput::genTextureWithI420(int width,
 
   for (int i = 0; i < 3; ++i) {
     glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(GL_TEXTURE_2D, _textures[i]);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, widths[i], heights[i], 0,
-                 GL_LUMINANCE, GL_UNSIGNED_BYTE, pixels[i]);
+    uploadTexture(i, GL_LUMINANCE, GL_LUMINANCE, widths[i], heights[i],
+                  pixels[i]);
   }
   
   _filterProgram->setUniformValue("texture_type", 0);
@@ -223,35 +219,23 @@ int SourceRawDataInput::genTextureWithRGBA(const uint8_t* pixels,
   this->setFramebuffer(_framebuffer, NoRotation);
 
   GLuint texture = _textures[3];
-  CHECK_GL(glBindTexture(GL_TEXTURE_2D, texture));
-
 #if defined(GPUPIXEL_IOS) || defined(GPUPIXEL_MAC)
-  CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, stride, height, 0, GL_BGRA,
-                        GL_UNSIGNED_BYTE, pixels));
+  uploadTexture(3, GL_RGBA, GL_BGRA, stride, height, pixels);
 #else
-  CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, stride, height, 0, GL_RGBA,
-                        GL_UNSIGNED_BYTE, pixels));
+  uploadTexture(3, GL_RGBA, GL_RGBA, stride, height, pixels);
 #endif
 
   GPUPixelContext::getInstance()->setActiveShaderProgram(_filterProgram);
   this->getFramebuffer()->active();
 
-  GLfloat imageVertices[]{
-    -1.0f, -1.0f,
-    1.0f, -1.0f,
-    -1.0f, 1.0f,
-    1.0f, 1.0f,
-  };
-
   _filterProgram->setUniformValue("texture_type", 1);
 
   CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
   CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-                                 _getTexureCoordinate(_rotation)));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(
+      _filterTexCoordAttribute, _rotation);
 
   CHECK_GL(glActiveTexture(GL_TEXTURE4));
   CHECK_GL(glBindTexture(GL_TEXTURE_2D, texture));
@@ -264,3 +248,24 @@ int SourceRawDataInput::genTextureWithRGBA(const uint8_t* pixels,
   Source::proceed(true, ts);
   return 0;
 }
+
+void SourceRawDataInput::uploadTexture(int index,
+                                       GLint internalFormat,
+                                       GLenum format,
+                                       int width,
+                                       int height,
+                                       const uint8_t* pixels) {
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D, _textures[index]));
+  // Rows are tightly packed, other uploads may have changed the alignment
+  CHECK_GL(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+  if (_textureWidths[index] != width || _textureHeights[index] != height) {
+    CHECK_GL(glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0,
+                          format, GL_UNSIGNED_BYTE, pixels));
+    _textureWidths[index] = width;
+    _textureHeights[index] = height;
+  } else {
+    // Same size as the last frame, overwrite without reallocating storage
+    CHECK_GL(glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format,
+                             GL_UNSIGNED_BYTE, pixels));
+  }
+}
@@ -52,12 +52,23 @@ class GPUPIXEL_API SourceRawDataInput : public Filter {
                          int stride,
                          int64_t ts = 0);
 
+  // Replaces the contents of _textures[index], its storage is only
+  // reallocated when the size changes
+  void uploadTexture(int index,
+                     GLint internalFormat,
+                     GLenum format,
+                     int width,
+                     int height,
+                     const uint8_t* pixels);
+
  private:
   GLProgram* _filterProgram;
   GLuint _filterPositionAttribute;
   GLuint _filterTexCoordAttribute;
 
   GLuint _textures[4] = {0};
+  int _textureWidths[4] = {0};
+  int _textureHeights[4] = {0};
   RotationMode _rotation = NoRotation;
   std::shared_ptr<Framebuffer> _framebuffer;
 };
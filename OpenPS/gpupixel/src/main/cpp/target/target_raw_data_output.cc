@@ -8,6 +8,7 @@
 
 #include "target_raw_data_output.h"
 #include "gpupixel_context.h"
+#include <algorithm>
 #include <cstring>
 #include "libyuv.h"
 USING_NS_GPUPIXEL
@@ -45,12 +46,6 @@ TargetRawDataOutput::TargetRawDataOutput() {
 }
 
 TargetRawDataOutput::~TargetRawDataOutput() {
-  // delete rgba frame buffer
-  if (_readPixelData != nullptr) {
-    delete[] _readPixelData;
-  }
-  _readPixelData = nullptr;
-
   // delete yuv frame buffer
   if (_yuvFrameBuffer != nullptr) {
     delete[] _yuvFrameBuffer;
@@ -135,24 +130,12 @@ int TargetRawDataOutput::renderToOutput() {
   glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  GLfloat imageVertices[] = {
-      -1.0, -1.0,  // left down
-      1.0,  -1.0,  // right down
-      -1.0, 1.0,   // left up
-      1.0,  1.0    // right up
-  };
-
-  GLfloat textureVertices[] = {
-      0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f,
-  };
-
   CHECK_GL(glEnableVertexAttribArray(_filterPositionAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterPositionAttribute, 2, GL_FLOAT, 0, 0,
-                                 imageVertices));
+  GPUPixelContext::getInstance()->setQuadPositionAttribute(_filterPositionAttribute);
 
   CHECK_GL(glEnableVertexAttribArray(_filterTexCoordAttribute));
-  CHECK_GL(glVertexAttribPointer(_filterTexCoordAttribute, 2, GL_FLOAT, 0, 0,
-                                 textureVertices));
+  GPUPixelContext::getInstance()->setQuadTexCoordAttribute(_filterTexCoordAttribute,
+                                                           NoRotation);
 
   glActiveTexture(GL_TEXTURE0);
   glBindTexture(GL_TEXTURE_2D, _inputFramebuffers[0].frameBuffer->getTexture());
@@ -180,22 +163,100 @@ void TargetRawDataOutput::setPixelsCallbck(RawOutputCallback cb) {
   pixels_callback_ = cb;
 }
 
-void TargetRawDataOutput::initOutputBuffer(int width, int height) {
-  uint32_t rgb_size = width * height * 4;
-  uint32_t yuv_size = width * height * 3 / 2;
+void TargetRawDataOutput::setSynchronousRead(bool synchronous) {
+  synchronous_read_ = synchronous;
+}
+
+void TargetRawDataOutput::beginTiledOutput(int width, int height) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  is_tiled_ = true;
+  tiled_width_ = width;
+  tiled_height_ = height;
+  tiled_pixels_.assign((size_t)width * height * 4, 0);
+  rows_callback_ = nullptr;
+  band_y_ = 0;
+  band_rows_ = height;
+  tile_ = {0, 0, 0, 0, 0, 0};
+}
 
-  // alloc rgba frame buffer
-  if (_readPixelData != nullptr) {
-    delete[] _readPixelData;
+void TargetRawDataOutput::beginTiledOutput(int width, int height,
+                                           RawOutputRowsCallback rowsCallback) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  is_tiled_ = true;
+  tiled_width_ = width;
+  tiled_height_ = height;
+  std::vector<uint8_t>().swap(tiled_pixels_);
+  rows_callback_ = rowsCallback;
+  band_y_ = 0;
+  band_rows_ = 0;
+  tile_ = {0, 0, 0, 0, 0, 0};
+}
+
+void TargetRawDataOutput::setOutputTile(int x, int y, int cropX, int cropY,
+                                        int cropWidth, int cropHeight) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  tile_ = {x, y, cropX, cropY, cropWidth, cropHeight};
+  if (rows_callback_ && (band_rows_ == 0 || y != band_y_)) {
+    // A new row of tiles, the previous one is complete
+    flushOutputBand();
+    band_y_ = y;
+    band_rows_ = cropHeight;
+    if (x == 0 && cropWidth >= tiled_width_) {
+      // Full width tiles stream their rows directly
+      std::vector<uint8_t>().swap(tiled_pixels_);
+    } else {
+      tiled_pixels_.assign((size_t)tiled_width_ * cropHeight * 4, 0);
+    }
   }
-  _readPixelData = new uint8_t[rgb_size];
-  std::memset(_readPixelData, 0, rgb_size);
-  // alloc yuv frame buffer
+}
+
+void TargetRawDataOutput::endTiledOutput() {
+  std::unique_lock<std::mutex> lck(mtx_);
+  is_tiled_ = false;
+  if (rows_callback_) {
+    flushOutputBand();
+    rows_callback_ = nullptr;
+  } else if (pixels_callback_) {
+    pixels_callback_(tiled_pixels_.data(), tiled_width_, tiled_height_,
+                     _frame_ts);
+  }
+  std::vector<uint8_t>().swap(tiled_pixels_);
+}
+
+void TargetRawDataOutput::flushOutputBand() {
+  if (rows_callback_ && band_rows_ > 0 && !tiled_pixels_.empty()) {
+    rows_callback_(std::move(tiled_pixels_), tiled_width_, band_y_,
+                   band_rows_);
+    tiled_pixels_.clear();
+  }
+  band_rows_ = 0;
+}
+
+void TargetRawDataOutput::initOutputBuffer(int width, int height) {
+  // The yuv frame buffer is allocated by the first frame an I420 callback
+  // asks for, at the new size
   if (_yuvFrameBuffer != nullptr) {
     delete[] _yuvFrameBuffer;
   }
-  _yuvFrameBuffer = new uint8_t[yuv_size];
-  std::memset(_yuvFrameBuffer, 0, yuv_size);
+  _yuvFrameBuffer = nullptr;
+}
+
+uint8_t* TargetRawDataOutput::convertToI420(const uint8_t* pixels, int stride,
+                                            bool bgra) {
+  if (_yuvFrameBuffer == nullptr) {
+    _yuvFrameBuffer = new uint8_t[_width * _height * 3 / 2];
+  }
+  uint8_t* dataY = _yuvFrameBuffer;
+  uint8_t* dataU = dataY + _width * _height;
+  uint8_t* dataV = dataU + _width * _height / 4;
+  if (bgra) {
+    libyuv::ARGBToI420(pixels, stride, dataY, _width, dataU, _width / 2, dataV,
+                       _width / 2, _width, _height);
+  } else {
+    libyuv::ABGRToI420(pixels, stride, dataY, _width, dataU, _width / 2, dataV,
+                       _width / 2, _width, _height);
+  }
+  return _yuvFrameBuffer;
 }
 
 #if defined(GPUPIXEL_IOS)
@@ -207,11 +268,8 @@ void TargetRawDataOutput::readPixelsFromCVPixelBuffer() {
 
     // process pixels how you like
     if (pixels && i420_callback_) {
-      libyuv::ARGBToI420(pixels, stride, _yuvFrameBuffer, _width,
-                        _yuvFrameBuffer + _width * _height, _width
-                        / 2, _yuvFrameBuffer + _width * _height * 5
-                        / 4, _width / 2, _width, _height);
-      i420_callback_(_yuvFrameBuffer, _width, _height, _frame_ts);
+      i420_callback_(convertToI420(pixels, stride, true), _width, _height,
+                     _frame_ts);
     }
 
     if(pixels_callback_) {
@@ -299,6 +357,9 @@ void TargetRawDataOutput::initFrameBuffer(int width, int height) {
 }
 
 void TargetRawDataOutput::initPBO(int width, int height) {
+  if (pboIds[0] != 0) {
+    CHECK_GL(glDeleteBuffers(PBO_SIZE, pboIds));
+  }
   CHECK_GL(glGenBuffers(PBO_SIZE, pboIds));
   for (int i = 0; i < PBO_SIZE; ++i) {
     CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds[i]));
@@ -306,12 +367,34 @@ void TargetRawDataOutput::initPBO(int width, int height) {
                           GL_STREAM_READ));
   }
   CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, 0));
+  previous_frame_read_ = false;
 }
 
 // read pixel with pbo
 void TargetRawDataOutput::readPixelsWithPBO(int width, int height) {
+  bool tiled;
+  RawOutputCallback i420Callback;
+  RawOutputCallback pixelsCallback;
+  {
+    std::unique_lock<std::mutex> lck(mtx_);
+    tiled = is_tiled_;
+    i420Callback = i420_callback_;
+    pixelsCallback = pixels_callback_;
+  }
+  if (tiled) {
+    readTileWithPBO(width, height);
+    return;
+  }
+  if (!i420Callback && !pixelsCallback) {
+    // Nobody reads the frame, skip the transfer
+    previous_frame_read_ = false;
+    return;
+  }
   index = (index + 1) % 2;
-  nextIndex = (index + 1) % 2;
+  // The other PBO only holds a frame if the previous one was read into it
+  nextIndex = (synchronous_read_ || !previous_frame_read_) ? index
+                                                           : (index + 1) % 2;
+  previous_frame_read_ = true;
 
   // read pixels from framebuffer to PBO
   // glReadPixels() should return immediately.
@@ -327,18 +410,72 @@ void TargetRawDataOutput::readPixelsWithPBO(int width, int height) {
                   GL_PIXEL_PACK_BUFFER, 0, width * height * 4, GL_MAP_READ_BIT);
 #endif
   if (ptr) {
-       libyuv::ABGRToI420(ptr, width * 4, _yuvFrameBuffer, _width,
-                          _yuvFrameBuffer + _width * _height, _width / 2,
-                          _yuvFrameBuffer + _width * _height * 5 / 4, _width
-                          / 2, _width, _height);
-    if (i420_callback_) {
-      i420_callback_(_yuvFrameBuffer, _width, _height, _frame_ts);
+    // Converted only for an I420 consumer, most outputs just want RGBA
+    if (i420Callback) {
+      i420Callback(convertToI420(ptr, width * 4, false), _width, _height,
+                   _frame_ts);
     }
 
-    if(pixels_callback_) {
-      pixels_callback_(ptr, _width, _height, _frame_ts);
+    if (pixelsCallback) {
+      pixelsCallback(ptr, _width, _height, _frame_ts);
+    }
+
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
+}
+
+// Reads the crop of the current tile in row bands. Band n + 1 is packed into
+// one PBO while band n is mapped from the other, so the copy overlaps with the
+// transfer.
+void TargetRawDataOutput::readTileWithPBO(int width, int height) {
+  std::unique_lock<std::mutex> lck(mtx_);
+  int cropWidth = std::min(tile_.cropWidth, width - tile_.cropX);
+  int cropHeight = std::min(tile_.cropHeight, height - tile_.cropY);
+  if (cropWidth <= 0 || cropHeight <= 0) {
+    return;
+  }
+  bool direct = rows_callback_ && tiled_pixels_.empty();
+  int bandRows = std::min(kStreamBandRows, cropHeight);
+  int bandCount = (cropHeight + bandRows - 1) / bandRows;
+
+  for (int band = 0; band <= bandCount; ++band) {
+    if (band < bandCount) {
+      // Rows come out bottom-up from GL, which is image row order here since
+      // sources upload row 0 to t = 0
+      int rows = std::min(bandRows, cropHeight - band * bandRows);
+      CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds[band % PBO_SIZE]));
+      CHECK_GL(glReadPixels(tile_.cropX, tile_.cropY + band * bandRows,
+                            cropWidth, rows, GL_RGBA, GL_UNSIGNED_BYTE, 0));
+    }
+    if (band == 0) {
+      continue;
     }
 
+    int mapped = band - 1;
+    int rows = std::min(bandRows, cropHeight - mapped * bandRows);
+    CHECK_GL(glBindBuffer(GL_PIXEL_PACK_BUFFER, pboIds[mapped % PBO_SIZE]));
+#if defined(GPUPIXEL_MAC) || defined(GPUPIXEL_WIN) || defined(GPUPIXEL_LINUX)
+    GLubyte* ptr = (GLubyte*)glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+#elif defined(GPUPIXEL_ANDROID)
+    GLubyte* ptr = (GLubyte*)glMapBufferRange(
+        GL_PIXEL_PACK_BUFFER, 0, cropWidth * rows * 4, GL_MAP_READ_BIT);
+#endif
+    if (!ptr) {
+      continue;
+    }
+    int y = tile_.y + mapped * bandRows;
+    if (direct) {
+      rows_callback_(std::vector<uint8_t>(ptr, ptr + (size_t)cropWidth * rows * 4),
+                     tiled_width_, y, rows);
+    } else {
+      for (int row = 0; row < rows; ++row) {
+        std::memcpy(tiled_pixels_.data() +
+                        ((size_t)(y - band_y_ + row) * tiled_width_ + tile_.x) *
+                            4,
+                    ptr + (size_t)row * cropWidth * 4, (size_t)cropWidth * 4);
+      }
+    }
     glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
   }
   glBindBuffer(GL_PIXEL_PACK_BUFFER, GL_NONE);
@@ -19,10 +19,16 @@
 #endif
 
 #include <mutex>
+#include <vector>
 NS_GPUPIXEL_BEGIN
 GPUPIXEL_API typedef std::function<
     void(const uint8_t* data, int width, int height, int64_t ts)>
     RawOutputCallback;
+// Receives `rows` tightly packed RGBA rows of a width wide image, starting at
+// image row y. The band buffer is handed over, not copied.
+GPUPIXEL_API typedef std::function<
+    void(std::vector<uint8_t> data, int width, int y, int rows)>
+    RawOutputRowsCallback;
     
 #define PBO_SIZE 2
 
@@ -34,6 +40,26 @@ class GPUPIXEL_API TargetRawDataOutput : public Target {
   void update(int64_t frameTime) override;
   void setI420Callbck(RawOutputCallback cb);
   void setPixelsCallbck(RawOutputCallback cb);
+  // Map the PBO of the frame just rendered instead of the previous one, for
+  // one-shot reads that can't wait for a second frame
+  void setSynchronousRead(bool synchronous);
+
+  // Frames rendered between beginTiledOutput() and endTiledOutput() are
+  // stitched into one width x height RGBA image, which endTiledOutput()
+  // hands to the pixels callback
+  void beginTiledOutput(int width, int height);
+  // Streaming variant: instead of stitching, finished rows go to
+  // rowsCallback top-down, read back through the PBOs in bands of at most
+  // kStreamBandRows rows. Only one row of tiles is held on the CPU, so tiles
+  // narrower than the image should have cores kStreamBandRows rows tall.
+  static constexpr int kStreamBandRows = 256;
+  void beginTiledOutput(int width, int height,
+                        RawOutputRowsCallback rowsCallback);
+  // Copies the (cropX, cropY, cropWidth, cropHeight) part of the next frame
+  // to (x, y) of the stitched image
+  void setOutputTile(int x, int y, int cropX, int cropY, int cropWidth,
+                     int cropHeight);
+  void endTiledOutput();
  private:
   int renderToOutput();
   bool initWithShaderString(const std::string& vertexShaderSource,
@@ -44,8 +70,12 @@ class GPUPIXEL_API TargetRawDataOutput : public Target {
   void readPixelsFromCVPixelBuffer();
 #endif
   void initOutputBuffer(int width, int height);
+  // Converts a frame of RGBA (or BGRA) pixels into _yuvFrameBuffer
+  uint8_t* convertToI420(const uint8_t* pixels, int stride, bool bgra);
   void initPBO(int width, int height);
   void readPixelsWithPBO(int width, int height);
+  void readTileWithPBO(int width, int height);
+  void flushOutputBand();
 
  private:
   std::mutex mtx_;
@@ -76,14 +106,28 @@ class GPUPIXEL_API TargetRawDataOutput : public Target {
   int32_t _height = 0;
   int64_t _frame_ts = 0;
 
-  // rgb buffer
-  uint8_t* _readPixelData = nullptr;
+  // i420 buffer, only allocated while an I420 callback is set
   uint8_t* _yuvFrameBuffer = nullptr;
   // callback
   RawOutputCallback i420_callback_ = nullptr;
   RawOutputCallback pixels_callback_ = nullptr;
 
   bool current_frame_invalid_ = true;
+  bool synchronous_read_ = false;
+  bool previous_frame_read_ = false;
+
+  // tiled output, guarded by mtx_
+  bool is_tiled_ = false;
+  std::vector<uint8_t> tiled_pixels_;
+  int32_t tiled_width_ = 0;
+  int32_t tiled_height_ = 0;
+  // streamed tiled output, tiled_pixels_ then holds the band of tiles at band_y_
+  RawOutputRowsCallback rows_callback_ = nullptr;
+  int32_t band_y_ = 0;
+  int32_t band_rows_ = 0;
+  struct {
+    int x, y, cropX, cropY, cropWidth, cropHeight;
+  } tile_;
 };
 
 NS_GPUPIXEL_END
@@ -9,6 +9,7 @@
 #include "gpupixel_context.h"
 #include "util.h"
 #include "filter.h"
+#include <cmath>
 
 USING_NS_GPUPIXEL
 
@@ -33,6 +34,11 @@ TargetView::~TargetView() {
     delete _displayProgram;
     _displayProgram = 0;
   }
+  if (_vertexBuffer) {
+    GLuint vertexBuffer = _vertexBuffer;
+    GPUPixelContext::getInstance()->runSync(
+        [=] { glDeleteBuffers(1, &vertexBuffer); });
+  }
 }
 
 void TargetView::init() {
@@ -88,6 +94,10 @@ void TargetView::setMirror(bool mirror) {
 }
 
 
+void TargetView::setMipmapEnabled(bool enabled) {
+  _mipmapEnabled = enabled;
+}
+
 void TargetView::onSizeChanged(int width, int height) {
   if (_viewWidth != width || _viewHeight != height) {
     _viewWidth = width;
@@ -120,21 +130,72 @@ bool TargetView::updateMatrixState() {
   CHECK_GL(glBindFramebuffer(GL_FRAMEBUFFER, 0));
   CHECK_GL(glViewport(0, 0, _viewWidth, _viewHeight));
 
+  // Sampling a much larger texture with GL_LINEAR aliases and thrashes the
+  // texture cache, so minified draws go through the mip chain instead
+  std::shared_ptr<Framebuffer> inputFramebuffer =
+      _inputFramebuffers[0].frameBuffer;
+  bool useMipmaps =
+      _mipmapEnabled &&
+      _isMinified(inputFramebuffer, _inputFramebuffers[0].rotationMode) &&
+      inputFramebuffer->generateMipmaps();
+
   CHECK_GL(glActiveTexture(GL_TEXTURE0));
-  CHECK_GL(glBindTexture(GL_TEXTURE_2D,
-                         _inputFramebuffers[0].frameBuffer->getTexture()));
+  CHECK_GL(glBindTexture(GL_TEXTURE_2D, inputFramebuffer->getTexture()));
+  if (useMipmaps) {
+    CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                             GL_LINEAR_MIPMAP_LINEAR));
+  }
   CHECK_GL(glUniform1i(_colorMapUniformLocation, 0));
 
-  CHECK_GL(glVertexAttribPointer(_positionAttribLocation, 2, GL_FLOAT, 0, 0,
-                                 _displayVertices));
-  CHECK_GL(glVertexAttribPointer(
-      _texCoordAttribLocation, 2, GL_FLOAT, 0, 0,
-      _getTexureCoordinate(_inputFramebuffers[0].rotationMode)));
+  const GLfloat* texCoords =
+      _getTexureCoordinate(_inputFramebuffers[0].rotationMode);
+  if (!_vertexBuffer) {
+    CHECK_GL(glGenBuffers(1, &_vertexBuffer));
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer));
+    CHECK_GL(glBufferData(GL_ARRAY_BUFFER, 16 * sizeof(GLfloat), nullptr,
+                          GL_DYNAMIC_DRAW));
+    _vertexBufferDirty = true;
+  } else {
+    CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, _vertexBuffer));
+  }
+  if (_vertexBufferDirty || texCoords != _bufferTexCoords) {
+    CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 0, 8 * sizeof(GLfloat),
+                             _displayVertices));
+    CHECK_GL(glBufferSubData(GL_ARRAY_BUFFER, 8 * sizeof(GLfloat),
+                             8 * sizeof(GLfloat), texCoords));
+    _vertexBufferDirty = false;
+    _bufferTexCoords = texCoords;
+  }
+  // Other programs may have disabled these indices since init
+  CHECK_GL(glEnableVertexAttribArray(_positionAttribLocation));
+  CHECK_GL(glEnableVertexAttribArray(_texCoordAttribLocation));
+  CHECK_GL(glVertexAttribPointer(_positionAttribLocation, 2, GL_FLOAT, 0, 0, 0));
+  CHECK_GL(glVertexAttribPointer(_texCoordAttribLocation, 2, GL_FLOAT, 0, 0,
+                                 (const GLvoid*)(8 * sizeof(GLfloat))));
+  CHECK_GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
   CHECK_GL(glDrawArrays(GL_TRIANGLE_STRIP, 0, 4));
+
+  if (useMipmaps) {
+    // The framebuffer goes back to the cache, restore its own min filter
+    CHECK_GL(glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                             inputFramebuffer->getTextureAttributes().minFilter));
+  }
   return true;
 }
 
+bool TargetView::_isMinified(std::shared_ptr<Framebuffer> framebuffer,
+                             RotationMode rotationMode) const {
+  int framebufferWidth = rotationSwapsSize(rotationMode)
+                             ? framebuffer->getHeight()
+                             : framebuffer->getWidth();
+  // _displayVertices spans [-x, x] of the 2 unit wide clip space
+  float zoom = std::sqrt(_mvpMatrix.m[0] * _mvpMatrix.m[0] +
+                         _mvpMatrix.m[1] * _mvpMatrix.m[1]);
+  float displayedWidth = std::fabs(_displayVertices[2]) * _viewWidth * zoom;
+  return framebufferWidth > displayedWidth;
+}
+
 void TargetView::onCompareBegin() {
   _isCompare = true;
 }
@@ -218,6 +279,7 @@ void TargetView::_updateDisplayVertices() {
     _displayVertices[6] = scaledWidth;
     _displayVertices[7] = scaledHeight;
   }
+  _vertexBufferDirty = true;
   Util::Log("TargetView", "updateDisplayVertices, isNotInit=%d, isCompare=%d", isNotInit, _isCompare);
 
   _scaledWidth = scaledWidth;
@@ -30,6 +30,7 @@ class GPUPIXEL_API TargetView : public Target {
                                    int texIdx = 0) override;
   void setFillMode(FillMode fillMode);
   void setMirror(bool mirror);
+  void setMipmapEnabled(bool enabled);
   void onSizeChanged(int width, int height);
   void getViewInfo(float* info);
   void setMVPMatrix(const Matrix4& mvpMatrix);
@@ -48,6 +49,7 @@ class GPUPIXEL_API TargetView : public Target {
   FillMode _fillMode;
   bool _mirror = false;
   bool _isCompare = false;
+  bool _mipmapEnabled = true;
   GLProgram* _displayProgram;
   GLuint _positionAttribLocation;
   GLuint _texCoordAttribLocation;
@@ -61,9 +63,16 @@ class GPUPIXEL_API TargetView : public Target {
   } _backgroundColor;
 
   GLfloat _displayVertices[8];
+  // _displayVertices, then the texture coordinates in use. Uploaded again
+  // only when either changes.
+  GLuint _vertexBuffer = 0;
+  bool _vertexBufferDirty = true;
+  const GLfloat* _bufferTexCoords = nullptr;
   Matrix4 _mvpMatrix = Matrix4::IDENTITY;
 
   void _updateDisplayVertices();
+  bool _isMinified(std::shared_ptr<Framebuffer> framebuffer,
+                   RotationMode rotationMode) const;
   const GLfloat* _getTexureCoordinate(RotationMode rotationMode);
 };
 
@@ -2,7 +2,7 @@
 
 void LocalDispatchQueue::add(std::function<void()> task) {
     std::unique_lock lk(m);
-    taskQueue.push(task);
+    taskQueue.push(std::move(task));
 }
 
 void LocalDispatchQueue::processOne() {
@@ -12,7 +12,7 @@ void LocalDispatchQueue::processOne() {
         if (taskQueue.empty())
             return;
 
-        task = taskQueue.front();
+        task = std::move(taskQueue.front());
         taskQueue.pop();
     }
     task();
@@ -26,16 +26,16 @@ void LocalDispatchQueue::processAll() {
             if (taskQueue.empty())
                 return;
 
-            task = taskQueue.front();
+            task = std::move(taskQueue.front());
             taskQueue.pop();
         }
         task();
     }
 }
 
-void DispatchQueue::worker(size_t id) {
+void DispatchQueue::worker([[maybe_unused]] size_t id) {
     std::function<void()> task;
-    while (running) {
+    for (;;) {
         {
             std::unique_lock lk(m);
             cv.wait(lk, [&]() {
@@ -45,15 +45,20 @@ void DispatchQueue::worker(size_t id) {
             if (!running)
                 break;
 
-            task = taskQueue.front();
+            task = std::move(taskQueue.front());
             taskQueue.pop();
             nWorking++;
         }
         task();
+        task = nullptr;
+        bool idle;
         {
             std::unique_lock lk(m);
             nWorking--;
+            idle = nWorking == 0 && taskQueue.empty();
         }
+        if (idle)
+            idleCv.notify_all();
     }
 }
 
@@ -82,6 +87,7 @@ void DispatchQueue::stop() {
         running = false;
     }
     cv.notify_all();
+    idleCv.notify_all();
     for (auto & worker : workers) {
         worker.join();
     }
@@ -89,7 +95,11 @@ void DispatchQueue::stop() {
 }
 
 void DispatchQueue::wait() {
-    while (busy()) std::this_thread::yield();
+    std::unique_lock lk(m);
+    // Tasks left behind by stop() never run
+    idleCv.wait(lk, [&]() {
+        return nWorking == 0 && (taskQueue.empty() || !running);
+    });
 }
 
 void DispatchQueue::join() {
@@ -64,6 +64,8 @@ private:
     int nWorking;
     std::mutex m;
     std::condition_variable cv;
+    // Signalled when the last running task finishes and the queue is empty
+    std::condition_variable idleCv;
     std::queue<std::function<void()>> taskQueue;
     std::vector<std::thread> workers;
 
@@ -94,7 +96,8 @@ public:
     void stop();
 
     /**
-     * Wait for all tasks to start execution.
+     * Wait until the queue is empty and no task is executing. Blocks on a
+     * condition variable instead of polling.
      */
     void wait();
 
@@ -0,0 +1,165 @@
+/*
+ * PngStreamWriter
+ */
+
+#include "png_stream_writer.h"
+#include <cstring>
+#include "util.h"
+
+NS_GPUPIXEL_BEGIN
+
+namespace {
+constexpr uint8_t kPngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+constexpr uint8_t kFilterUp = 2;
+constexpr size_t kIdatChunkSize = 64 * 1024;
+
+void putUint32(uint8_t* dst, uint32_t value) {
+  dst[0] = (uint8_t) (value >> 24);
+  dst[1] = (uint8_t) (value >> 16);
+  dst[2] = (uint8_t) (value >> 8);
+  dst[3] = (uint8_t) value;
+}
+}  // namespace
+
+PngStreamWriter::~PngStreamWriter() {
+  if (file_) {
+    abort();
+  }
+}
+
+bool PngStreamWriter::open(const std::string& path, int width, int height,
+                           int compressionLevel) {
+  if (file_ || width <= 0 || height <= 0) {
+    return false;
+  }
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) {
+    Util::Log("PngStreamWriter", "open: cannot create %s", path.c_str());
+    return false;
+  }
+  path_ = path;
+  width_ = width;
+  height_ = height;
+  rows_written_ = 0;
+  previous_row_.assign((size_t) width * 4, 0);
+  filtered_row_.resize((size_t) width * 4 + 1);
+  idat_buffer_.resize(kIdatChunkSize);
+
+  stream_ = {};
+  if (deflateInit(&stream_, compressionLevel) != Z_OK) {
+    abort();
+    return false;
+  }
+  stream_initialized_ = true;
+  stream_.next_out = idat_buffer_.data();
+  stream_.avail_out = (uInt) idat_buffer_.size();
+
+  uint8_t header[13];
+  putUint32(header, (uint32_t) width);
+  putUint32(header + 4, (uint32_t) height);
+  header[8] = 8;   // bit depth
+  header[9] = 6;   // color type RGBA
+  header[10] = 0;  // deflate
+  header[11] = 0;  // adaptive filtering
+  header[12] = 0;  // no interlace
+  if (fwrite(kPngSignature, 1, sizeof(kPngSignature), file_) != sizeof(kPngSignature) ||
+      !writeChunk("IHDR", header, sizeof(header))) {
+    abort();
+    return false;
+  }
+  return true;
+}
+
+bool PngStreamWriter::writeRows(const uint8_t* pixels, int rows) {
+  if (!file_ || rows_written_ + rows > height_) {
+    return false;
+  }
+  size_t stride = (size_t) width_ * 4;
+  for (int row = 0; row < rows; ++row) {
+    const uint8_t* src = pixels + stride * row;
+    filtered_row_[0] = kFilterUp;
+    for (size_t i = 0; i < stride; ++i) {
+      filtered_row_[i + 1] = (uint8_t) (src[i] - previous_row_[i]);
+    }
+    memcpy(previous_row_.data(), src, stride);
+    ++rows_written_;
+    if (!deflateRow(filtered_row_.data(),
+                    rows_written_ == height_ ? Z_FINISH : Z_NO_FLUSH)) {
+      abort();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool PngStreamWriter::close() {
+  if (!file_) {
+    return false;
+  }
+  if (rows_written_ != height_) {
+    Util::Log("PngStreamWriter", "close: %d of %d rows written", rows_written_, height_);
+    abort();
+    return false;
+  }
+  deflateEnd(&stream_);
+  stream_initialized_ = false;
+  bool ok = writeChunk("IEND", nullptr, 0);
+  ok = (fclose(file_) == 0) && ok;
+  file_ = nullptr;
+  if (!ok) {
+    remove(path_.c_str());
+  }
+  return ok;
+}
+
+bool PngStreamWriter::writeChunk(const char* type, const uint8_t* data, uint32_t length) {
+  uint8_t head[8];
+  putUint32(head, length);
+  memcpy(head + 4, type, 4);
+  uLong crc = crc32(0, head + 4, 4);
+  if (length > 0) {
+    crc = crc32(crc, data, length);
+  }
+  uint8_t tail[4];
+  putUint32(tail, (uint32_t) crc);
+  return fwrite(head, 1, sizeof(head), file_) == sizeof(head) &&
+         (length == 0 || fwrite(data, 1, length, file_) == length) &&
+         fwrite(tail, 1, sizeof(tail), file_) == sizeof(tail);
+}
+
+bool PngStreamWriter::deflateRow(const uint8_t* row, int flush) {
+  stream_.next_in = const_cast<Bytef*>(row);
+  stream_.avail_in = (uInt) filtered_row_.size();
+  for (;;) {
+    int ret = deflate(&stream_, flush);
+    if (ret == Z_STREAM_ERROR) {
+      return false;
+    }
+    bool finished = ret == Z_STREAM_END;
+    if (stream_.avail_out == 0 || (finished && stream_.avail_out < idat_buffer_.size())) {
+      uint32_t length = (uint32_t) (idat_buffer_.size() - stream_.avail_out);
+      if (!writeChunk("IDAT", idat_buffer_.data(), length)) {
+        return false;
+      }
+      stream_.next_out = idat_buffer_.data();
+      stream_.avail_out = (uInt) idat_buffer_.size();
+    }
+    if (finished || (flush != Z_FINISH && stream_.avail_in == 0 && stream_.avail_out > 0)) {
+      return true;
+    }
+  }
+}
+
+void PngStreamWriter::abort() {
+  if (stream_initialized_) {
+    deflateEnd(&stream_);
+    stream_initialized_ = false;
+  }
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+    remove(path_.c_str());
+  }
+}
+
+NS_GPUPIXEL_END
@@ -0,0 +1,61 @@
+/*
+ * PngStreamWriter
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <zlib.h>
+#include "gpupixel_macros.h"
+
+NS_GPUPIXEL_BEGIN
+
+/**
+ * Encodes an 8-bit RGBA image to a PNG file row by row, so the whole image
+ * never has to be in memory at once. Rows are written top-down with the "Up"
+ * filter and deflated straight into IDAT chunks.
+ */
+class GPUPIXEL_API PngStreamWriter {
+ public:
+  PngStreamWriter() = default;
+  ~PngStreamWriter();
+
+  PngStreamWriter(const PngStreamWriter&) = delete;
+  PngStreamWriter& operator=(const PngStreamWriter&) = delete;
+
+  bool open(const std::string& path, int width, int height,
+            int compressionLevel = Z_DEFAULT_COMPRESSION);
+
+  /**
+   * Appends rows of tightly packed RGBA pixels. Fails if more rows than the
+   * image height are written.
+   */
+  bool writeRows(const uint8_t* pixels, int rows);
+
+  /**
+   * Finishes the file. Fails if fewer rows than the image height were written,
+   * in which case the partial file is removed.
+   */
+  bool close();
+
+ private:
+  bool writeChunk(const char* type, const uint8_t* data, uint32_t length);
+  bool deflateRow(const uint8_t* row, int flush);
+  void abort();
+
+  FILE* file_ = nullptr;
+  std::string path_;
+  z_stream stream_ = {};
+  bool stream_initialized_ = false;
+  int width_ = 0;
+  int height_ = 0;
+  int rows_written_ = 0;
+  std::vector<uint8_t> previous_row_;
+  std::vector<uint8_t> filtered_row_;
+  std::vector<uint8_t> idat_buffer_;
+};
+
+NS_GPUPIXEL_END
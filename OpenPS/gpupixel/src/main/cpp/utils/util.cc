@@ -231,6 +231,7 @@ void Util::Log(const std::string& tag,std::string format, ...) {
 #endif
 }
 
+#if defined(GPUPIXEL_ANDROID)
 void Util::onProgramCreated(int id, const char* filterName, bool isActive) {
   JavaVM* jvm = GetJVM();
   JNIEnv* env = GetEnv(jvm);
@@ -286,4 +287,6 @@ void Util::onActivateProgram(int id) {
   env->DeleteLocalRef(myObjectClass);
 }
 
+#endif
+
 NS_GPUPIXEL_END
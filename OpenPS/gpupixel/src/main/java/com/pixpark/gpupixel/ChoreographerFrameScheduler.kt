@@ -0,0 +1,23 @@
+package com.pixpark.gpupixel
+
+import android.view.Choreographer
+
+// Runs the frame callback of an UpdateCoalescer on the next vsync
+class ChoreographerFrameScheduler : UpdateCoalescer.FrameScheduler {
+    private val choreographer = Choreographer.getInstance()
+    private var frameCallback: Choreographer.FrameCallback? = null
+
+    override fun postFrame(callback: () -> Unit) {
+        val frameCallback = Choreographer.FrameCallback {
+            this.frameCallback = null
+            callback()
+        }
+        this.frameCallback = frameCallback
+        choreographer.postFrameCallback(frameCallback)
+    }
+
+    override fun cancelFrame() {
+        frameCallback?.let { choreographer.removeFrameCallback(it) }
+        frameCallback = null
+    }
+}
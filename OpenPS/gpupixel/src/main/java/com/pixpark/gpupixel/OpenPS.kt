@@ -11,7 +11,9 @@ internal object OpenPS {
         System.loadLibrary("vnn_face")
     }
 
-    external fun nativeInit()
+    external fun nativeInit(taskScheduler: Runnable)
+
+    external fun nativeProcessTasks()
 
     external fun nativeInitWithImage(width: Int, height: Int, channelCount: Int, bitmap: Bitmap, filename: String? = null)
 
@@ -44,6 +46,8 @@ internal object OpenPS {
 
     external fun nativeSetRawOutputCallback(receiver: Any)
 
+    external fun nativeExportToFile(path: String, receiver: Any)
+
     external fun nativeSetSmoothLevel(level: Float, addRecord: Boolean = false)
 
     external fun nativeSetWhiteLevel(level: Float, addRecord: Boolean = false)
@@ -18,15 +18,25 @@ import kotlinx.coroutines.withContext
 import kotlin.coroutines.resume
 import kotlin.coroutines.suspendCoroutine
 
-class OpenPSHelper(private val renderView: OpenPSRenderView) {
+class OpenPSHelper(
+    private val renderView: OpenPSRenderView,
+    frameScheduler: UpdateCoalescer.FrameScheduler = ChoreographerFrameScheduler()
+) {
     companion object {
         const val TAG = "OpenPSHelper"
     }
 
     private var landmarkCallback: GPUPixelLandmarkCallback? = null
     private var resultPixelsCallback: ((ByteArray, Int, Int, Long) -> Unit)? = null
+    private var exportFinishedCallback: ((Boolean) -> Unit)? = null
     private val scope = CoroutineScope(Dispatchers.Main + Job())
     private var savedBitmapCount = 0
+    private val updateCoalescer = UpdateCoalescer(frameScheduler) { updates ->
+        renderView.postOnGLThread {
+            updates.forEach { it() }
+            requestRender()
+        }
+    }
 
     fun initWithImage(bitmap: Bitmap) {
         val width = bitmap.width
@@ -34,7 +44,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
         val channelCount = BitmapUtils.getChannels(bitmap)
         val savedBitmapName = getSavedBitmapName()
 
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeInitWithImage(width, height, channelCount, bitmap, savedBitmapName)
         }
 
@@ -61,7 +71,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
         }
 
         withContext(Dispatchers.Main) {
-            renderView.postOnGLThread {
+            postOnGLThread {
                 OpenPS.nativeChangeImage(width, height, channelCount, bitmap, savedBitmapName, savedSkinMaskBitmapName)
                 requestRender()
             }
@@ -72,19 +82,19 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     }
 
     fun buildBasicRenderPipeline() {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeBuildBasicRenderPipeline()
         }
     }
 
     fun buildRealRenderPipeline() {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeBuildRealRenderPipeline()
         }
     }
 
     fun buildNoFaceRenderPipeline() {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeBuildNoFaceRenderPipeline()
         }
     }
@@ -94,119 +104,106 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     }
 
     fun setSmoothLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("smooth", addRecord) {
             OpenPS.nativeSetSmoothLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setWhiteLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("white", addRecord) {
             OpenPS.nativeSetWhiteLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setLipstickLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("lipstick", addRecord) {
             OpenPS.nativeSetLipstickLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setBlusherLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("blusher", addRecord) {
             OpenPS.nativeSetBlusherLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setEyeZoomLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("eyeZoom", addRecord) {
             OpenPS.nativeSetEyeZoomLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setFaceSlimLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("faceSlim", addRecord) {
             OpenPS.nativeSetFaceSlimLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setContrastLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("contrast", addRecord) {
             OpenPS.nativeSetContrastLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setExposureLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("exposure", addRecord) {
             OpenPS.nativeSetExposureLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setSaturationLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("saturation", addRecord) {
             OpenPS.nativeSetSaturationLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setSharpenLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("sharpen", addRecord) {
             OpenPS.nativeSetSharpenLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun setBrightnessLevel(level: Float, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("brightness", addRecord) {
             OpenPS.nativeSetBrightnessLevel(level, addRecord)
-            requestRender()
         }
     }
 
     fun applyCustomFilter(type: Int, level: Float = 1f, addRecord: Boolean = false) {
-        renderView.postOnGLThread {
+        postUpdate("customFilter", addRecord) {
             OpenPS.nativeApplyCustomFilter(type, level, addRecord)
-            requestRender()
         }
     }
 
     fun updateSkinMask(fileName: String = "skin_mask.png") {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeUpdateSkinMask(fileName)
             requestRender()
         }
     }
 
     fun onCompareBegin() {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeCompareBegin()
             requestRender()
         }
     }
 
     fun onCompareEnd() {
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeCompareEnd()
             requestRender()
         }
     }
 
     fun updateMVPMatrix(matrix: FloatArray) {
-        renderView.postOnGLThread {
+        postUpdate("mvpMatrix", false) {
             OpenPS.nativeUpdateMVPMatrix(matrix)
-            requestRender()
         }
     }
 
     suspend fun canUndo() = suspendCoroutine {
-        renderView.postOnGLThread {
+        postOnGLThread {
             val result = OpenPS.nativeCanUndo()
             requestRender()
             it.resume(result)
@@ -214,7 +211,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     }
 
     suspend fun canRedo() = suspendCoroutine {
-        renderView.postOnGLThread {
+        postOnGLThread {
             val result = OpenPS.nativeCanRedo()
             requestRender()
             it.resume(result)
@@ -222,7 +219,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     }
 
     suspend fun undo() = suspendCoroutine {
-        renderView.postOnGLThread {
+        postOnGLThread {
             val result = OpenPS.nativeUndo()
             requestRender()
             it.resume(result)
@@ -230,7 +227,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     }
 
     suspend fun redo() = suspendCoroutine {
-        renderView.postOnGLThread {
+        postOnGLThread {
             val result = OpenPS.nativeRedo()
             requestRender()
             it.resume(result)
@@ -241,7 +238,10 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
 
     fun destroy() {
         scope.cancel()
-        OpenPS.nativeDestroy()
+        // The GL objects can only be released on the GL thread
+        postOnGLThread {
+            OpenPS.nativeDestroy()
+        }
     }
 
     suspend fun getLandmark(): LandmarkResult = withContext(Dispatchers.Main) {
@@ -282,8 +282,22 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
         deferred.await()
     }
 
+    suspend fun exportToFile(path: String): Boolean = withContext(Dispatchers.Main) {
+        val deferred = CompletableDeferred<Boolean>()
+
+        exportFinishedCallback = { success ->
+            deferred.complete(success)
+        }
+        postOnGLThread {
+            OpenPS.nativeExportToFile(path, this@OpenPSHelper)
+            requestRender()
+        }
+
+        deferred.await()
+    }
+
     suspend fun getRenderViewInfo() = suspendCoroutine { continuation ->
-        renderView.postOnGLThread {
+        postOnGLThread {
             val info = OpenPS.nativeTargetViewGetInfo()
             if (info != null && info.size == 4) {
                 continuation.resume(RenderViewInfo(info[0], info[1], info[2], info[3]))
@@ -296,7 +310,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     private fun setLandmarkCallback(callback: GPUPixelLandmarkCallback) {
         landmarkCallback = callback
 
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeSetLandmarkCallback(this)
             requestRender()
         }
@@ -305,7 +319,7 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     private fun manualDetectFace(callback: GPUPixelLandmarkCallback) {
         landmarkCallback = callback
 
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeManualDetectFace(this)
             renderView.renderer.forceRenderImage = true
             requestRender()
@@ -315,12 +329,22 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     private fun setResultPixelsCallback(callback: (ByteArray, Int, Int, Long) -> Unit) {
         resultPixelsCallback = callback
 
-        renderView.postOnGLThread {
+        postOnGLThread {
             OpenPS.nativeSetRawOutputCallback(this)
             requestRender()
         }
     }
 
+    private fun postUpdate(key: String, addRecord: Boolean, update: () -> Unit) {
+        updateCoalescer.post(key, addRecord, update)
+    }
+
+    // Anything else posted to the GL thread runs after the pending updates
+    private fun postOnGLThread(block: () -> Unit) {
+        updateCoalescer.flush()
+        renderView.postOnGLThread { block() }
+    }
+
     private fun getSavedBitmapName() = "saved_bitmap_${savedBitmapCount++}.png"
 
     // C++层回调方法
@@ -331,4 +355,8 @@ class OpenPSHelper(private val renderView: OpenPSRenderView) {
     fun onResultPixels(data: ByteArray, width: Int, height: Int, ts: Long) {
         resultPixelsCallback?.invoke(data, width, height, ts)
     }
+
+    fun onExportFinished(success: Boolean) {
+        exportFinishedCallback?.invoke(success)
+    }
 }
\ No newline at end of file
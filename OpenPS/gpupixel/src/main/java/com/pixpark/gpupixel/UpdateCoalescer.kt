@@ -0,0 +1,49 @@
+package com.pixpark.gpupixel
+
+/**
+ * Parameter updates are merged and handed to [dispatch] once per frame of
+ * [frameScheduler], so a fast slider drag renders once per vsync instead of
+ * once per touch event. Only the latest update of each key is kept, except
+ * updates that add an undo record.
+ */
+class UpdateCoalescer(
+    private val frameScheduler: FrameScheduler,
+    private val dispatch: (List<() -> Unit>) -> Unit
+) {
+    interface FrameScheduler {
+        fun postFrame(callback: () -> Unit)
+        fun cancelFrame()
+    }
+
+    private val pendingUpdates = LinkedHashMap<String, () -> Unit>()
+    private var isFrameScheduled = false
+    private var recordUpdateCount = 0
+
+    fun post(key: String, addRecord: Boolean, update: () -> Unit) {
+        synchronized(pendingUpdates) {
+            val pendingKey = if (addRecord) "$key#${recordUpdateCount++}" else key
+            // Re-insert so the update keeps its order relative to recorded ones
+            pendingUpdates.remove(pendingKey)
+            pendingUpdates[pendingKey] = update
+            if (!isFrameScheduled) {
+                isFrameScheduled = true
+                frameScheduler.postFrame { flush() }
+            }
+        }
+    }
+
+    fun flush() {
+        val updates = synchronized(pendingUpdates) {
+            if (isFrameScheduled) {
+                isFrameScheduled = false
+                frameScheduler.cancelFrame()
+            }
+            val updates = pendingUpdates.values.toList()
+            pendingUpdates.clear()
+            updates
+        }
+        if (updates.isNotEmpty()) {
+            dispatch(updates)
+        }
+    }
+}
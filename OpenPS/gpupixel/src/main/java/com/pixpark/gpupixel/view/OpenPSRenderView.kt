@@ -10,6 +10,7 @@ import android.view.GestureDetector
 import android.view.MotionEvent
 import android.view.ScaleGestureDetector
 import com.pixpark.gpupixel.OpenGLTransformHelper
+import com.pixpark.gpupixel.OpenPS
 
 class OpenPSRenderView : GLSurfaceView {
     interface Callback {
@@ -42,7 +43,10 @@ class OpenPSRenderView : GLSurfaceView {
             override fun onFrameRateChanged(fps: Double) {
                 callback?.onFrameRateChanged(fps)
             }
-        })
+        }) {
+            // Native tasks queued from other threads run on this GL thread
+            queueEvent { OpenPS.nativeProcessTasks() }
+        }
         setRenderer(renderer)
         renderMode = RENDERMODE_WHEN_DIRTY
         scaleGestureDetector = ScaleGestureDetector(context, ScaleListener())
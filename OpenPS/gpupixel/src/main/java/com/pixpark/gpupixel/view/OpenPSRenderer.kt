@@ -5,7 +5,10 @@ import com.pixpark.gpupixel.OpenPS
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.opengles.GL10
 
-class OpenPSRenderer(private val callback: Callback) : GLSurfaceView.Renderer {
+class OpenPSRenderer(
+    private val callback: Callback,
+    private val taskScheduler: Runnable
+) : GLSurfaceView.Renderer {
     interface Callback {
         fun onFrameRateChanged(fps: Double)
     }
@@ -15,7 +18,7 @@ class OpenPSRenderer(private val callback: Callback) : GLSurfaceView.Renderer {
     var forceRenderImage = false
 
     override fun onSurfaceCreated(p0: GL10?, p1: EGLConfig?) {
-        OpenPS.nativeInit()
+        OpenPS.nativeInit(taskScheduler)
     }
 
     override fun onSurfaceChanged(p0: GL10?, p1: Int, p2: Int) {
@@ -0,0 +1,73 @@
+// Throughput and idle cost of DispatchQueue. Prints the time to run a batch
+// of trivial tasks on serial and concurrent queues, and checks that a thread
+// in wait() doesn't burn CPU while a long task runs.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include "dispatch_queue.h"
+
+namespace {
+constexpr int kTasks = 200000;
+constexpr int kLongTaskMillis = 200;
+// A parked waiter costs next to nothing, a spinning one a full core
+constexpr double kMaxIdleCpuShare = 0.25;
+
+double throughputMillis(DispatchQueue::QueueType type) {
+  DispatchQueue queue(type);
+  std::atomic<int> done{0};
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < kTasks; ++i) {
+    queue.add([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+  }
+  queue.wait();
+  double millis = std::chrono::duration<double, std::milli>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+  queue.join();
+  if (done != kTasks) {
+    std::printf("FAILED: %d of %d tasks ran\n", done.load(), kTasks);
+    return -1.0;
+  }
+  return millis;
+}
+
+// Process CPU time spent while one task sleeps and the caller waits for it,
+// as a share of the wall time
+double idleCpuShare() {
+  DispatchQueue queue(DispatchQueue::Serial);
+  std::clock_t cpuStart = std::clock();
+  auto start = std::chrono::steady_clock::now();
+  queue.add([] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(kLongTaskMillis));
+  });
+  queue.wait();
+  double wallMillis = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+  double cpuMillis = 1000.0 * (std::clock() - cpuStart) / CLOCKS_PER_SEC;
+  queue.join();
+  std::printf("wait() on a %d ms task: %.1f ms CPU over %.1f ms\n",
+              kLongTaskMillis, cpuMillis, wallMillis);
+  return cpuMillis / wallMillis;
+}
+}  // namespace
+
+int main() {
+  double serial = throughputMillis(DispatchQueue::Serial);
+  double concurrent = throughputMillis(DispatchQueue::Concurrent);
+  if (serial < 0 || concurrent < 0) {
+    return 1;
+  }
+  std::printf("%d trivial tasks: serial %.1f ms, concurrent %.1f ms\n", kTasks,
+              serial, concurrent);
+
+  double share = idleCpuShare();
+  if (share > kMaxIdleCpuShare) {
+    std::printf("FAILED: waiting used %.0f%% of a core\n", share * 100);
+    return 1;
+  }
+  return 0;
+}
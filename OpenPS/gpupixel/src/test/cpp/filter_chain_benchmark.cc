@@ -0,0 +1,277 @@
+// CPU cost of drawing a 20 filter chain the way Filter::proceed() does.
+// Replays the per pass GL calls twice: with client side vertex arrays and
+// attribute and uniform lookups by name, as before the shared quad buffer,
+// and with GPUPixelContext's quad buffer and locations cached at link time.
+// Reports the CPU time spent submitting each frame, and checks that
+// both paths render the same image.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+#include "headless_gl_context.h"
+
+namespace {
+constexpr int kFilters = 20;
+constexpr int kSize = 64;
+constexpr int kWarmupFrames = 50;
+constexpr int kFrames = 500;
+constexpr int kRounds = 3;
+
+const char* kVertexShader = R"(
+    attribute vec4 position; attribute vec4 inputTextureCoordinate;
+
+    varying vec2 textureCoordinate;
+    uniform mat4 mvpMatrix;
+
+    void main() {
+      gl_Position = mvpMatrix * position;
+      textureCoordinate = inputTextureCoordinate.xy;
+    })";
+
+// Every filter gets its own program, like a chain of different filters
+std::string fragmentShader(int filter) {
+  return "varying highp vec2 textureCoordinate;\n"
+         "uniform sampler2D inputImageTexture;\n"
+         "uniform lowp float intensity;\n"
+         "void main() {\n"
+         "  lowp vec4 color = texture2D(inputImageTexture, textureCoordinate);\n"
+         "  gl_FragColor = vec4(color.rgb * intensity + " +
+         std::to_string(filter % 5) + ".0 / 255.0, color.a);\n"
+         "}\n";
+}
+
+const GLfloat kIdentity[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+const GLfloat kPositions[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+const GLfloat kTexCoords[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+
+struct Pass {
+  GLuint program;
+  GLint position;
+  GLint texCoord;
+  GLint inputImageTexture;
+  GLint mvpMatrix;
+  GLint intensity;
+};
+
+struct Chain {
+  std::vector<Pass> passes;
+  GLuint quadBuffer = 0;
+  GLuint source = 0;
+  GLuint textures[2] = {0, 0};
+  GLuint framebuffers[2] = {0, 0};
+};
+
+GLuint compile(GLenum type, const std::string& source) {
+  GLuint shader = glCreateShader(type);
+  const char* text = source.c_str();
+  glShaderSource(shader, 1, &text, nullptr);
+  glCompileShader(shader);
+  GLint compiled = 0;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+  if (!compiled) {
+    char log[512];
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    std::printf("shader compile failed: %s\n", log);
+  }
+  return shader;
+}
+
+GLuint createTexture(const uint8_t* pixels) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, kSize, kSize, 0, GL_RGBA,
+               GL_UNSIGNED_BYTE, pixels);
+  return texture;
+}
+
+Chain createChain() {
+  Chain chain;
+  GLuint vertexShader = compile(GL_VERTEX_SHADER, kVertexShader);
+  for (int i = 0; i < kFilters; ++i) {
+    GLuint fragment = compile(GL_FRAGMENT_SHADER, fragmentShader(i));
+    Pass pass;
+    pass.program = glCreateProgram();
+    glAttachShader(pass.program, vertexShader);
+    glAttachShader(pass.program, fragment);
+    glLinkProgram(pass.program);
+    glDeleteShader(fragment);
+    pass.position = glGetAttribLocation(pass.program, "position");
+    pass.texCoord = glGetAttribLocation(pass.program, "inputTextureCoordinate");
+    pass.inputImageTexture =
+        glGetUniformLocation(pass.program, "inputImageTexture");
+    pass.mvpMatrix = glGetUniformLocation(pass.program, "mvpMatrix");
+    pass.intensity = glGetUniformLocation(pass.program, "intensity");
+    chain.passes.push_back(pass);
+  }
+  glDeleteShader(vertexShader);
+
+  std::vector<GLfloat> vertices(kPositions, kPositions + 8);
+  vertices.insert(vertices.end(), kTexCoords, kTexCoords + 8);
+  glGenBuffers(1, &chain.quadBuffer);
+  glBindBuffer(GL_ARRAY_BUFFER, chain.quadBuffer);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat),
+               vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  std::vector<uint8_t> pixels(kSize * kSize * 4);
+  for (size_t i = 0; i < pixels.size(); ++i) {
+    pixels[i] = (uint8_t)((i * 37) % 251);
+  }
+  chain.source = createTexture(pixels.data());
+  for (int i = 0; i < 2; ++i) {
+    chain.textures[i] = createTexture(nullptr);
+    glGenFramebuffers(1, &chain.framebuffers[i]);
+    glBindFramebuffer(GL_FRAMEBUFFER, chain.framebuffers[i]);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
+                           chain.textures[i], 0);
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return chain;
+}
+
+void destroyChain(Chain& chain) {
+  for (const Pass& pass : chain.passes) {
+    glDeleteProgram(pass.program);
+  }
+  glDeleteBuffers(1, &chain.quadBuffer);
+  glDeleteTextures(1, &chain.source);
+  glDeleteTextures(2, chain.textures);
+  glDeleteFramebuffers(2, chain.framebuffers);
+}
+
+// One frame through the chain, returns the framebuffer the last pass wrote
+int drawFrame(const Chain& chain, bool sharedBuffer) {
+  GLuint input = chain.source;
+  int output = 0;
+  for (const Pass& pass : chain.passes) {
+    glUseProgram(pass.program);
+    glBindFramebuffer(GL_FRAMEBUFFER, chain.framebuffers[output]);
+    glViewport(0, 0, kSize, kSize);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, input);
+
+    if (sharedBuffer) {
+      glUniform1i(pass.inputImageTexture, 0);
+      glUniformMatrix4fv(pass.mvpMatrix, 1, GL_FALSE, kIdentity);
+      glUniform1f(pass.intensity, 0.98f);
+      glEnableVertexAttribArray(pass.texCoord);
+      glBindBuffer(GL_ARRAY_BUFFER, chain.quadBuffer);
+      glVertexAttribPointer(pass.texCoord, 2, GL_FLOAT, 0, 0,
+                            (const GLvoid*)sizeof(kPositions));
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      glEnableVertexAttribArray(pass.position);
+      glBindBuffer(GL_ARRAY_BUFFER, chain.quadBuffer);
+      glVertexAttribPointer(pass.position, 2, GL_FLOAT, 0, 0, 0);
+      glBindBuffer(GL_ARRAY_BUFFER, 0);
+    } else {
+      glUniform1i(glGetUniformLocation(pass.program, "inputImageTexture"), 0);
+      glUniformMatrix4fv(glGetUniformLocation(pass.program, "mvpMatrix"), 1,
+                         GL_FALSE, kIdentity);
+      glUniform1f(glGetUniformLocation(pass.program, "intensity"), 0.98f);
+      GLint texCoord =
+          glGetAttribLocation(pass.program, "inputTextureCoordinate");
+      glEnableVertexAttribArray(texCoord);
+      glVertexAttribPointer(texCoord, 2, GL_FLOAT, 0, 0, kTexCoords);
+      GLint position = glGetAttribLocation(pass.program, "position");
+      glEnableVertexAttribArray(position);
+      glVertexAttribPointer(position, 2, GL_FLOAT, 0, 0, kPositions);
+    }
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+    input = chain.textures[output];
+    output = 1 - output;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return 1 - output;
+}
+
+double threadCpuMicros() {
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+struct Result {
+  double submitMicros;
+  double frameMicros;
+};
+
+// Per frame times, the lowest of kRounds runs. Submit time is the CPU time
+// the thread spends issuing the chain's calls, frame time also includes
+// waiting for the driver to finish it.
+Result measure(const Chain& chain, bool sharedBuffer) {
+  for (int i = 0; i < kWarmupFrames; ++i) {
+    drawFrame(chain, sharedBuffer);
+  }
+  glFinish();
+  Result best = {1e30, 1e30};
+  for (int round = 0; round < kRounds; ++round) {
+    double submit = 0.0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kFrames; ++i) {
+      double cpuStart = threadCpuMicros();
+      drawFrame(chain, sharedBuffer);
+      submit += threadCpuMicros() - cpuStart;
+      glFinish();
+    }
+    double wall = std::chrono::duration<double, std::micro>(
+                      std::chrono::steady_clock::now() - start)
+                      .count();
+    best.submitMicros = std::min(best.submitMicros, submit / kFrames);
+    best.frameMicros = std::min(best.frameMicros, wall / kFrames);
+  }
+  return best;
+}
+
+std::vector<uint8_t> readOutput(const Chain& chain, bool sharedBuffer) {
+  int output = drawFrame(chain, sharedBuffer);
+  std::vector<uint8_t> pixels(kSize * kSize * 4);
+  glBindFramebuffer(GL_FRAMEBUFFER, chain.framebuffers[output]);
+  glReadPixels(0, 0, kSize, kSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  return pixels;
+}
+}  // namespace
+
+int main() {
+  HeadlessGLContext context;
+  if (!context.isCurrent()) {
+    std::printf("no EGL display, skipped\n");
+    return kSkipReturnCode;
+  }
+
+  Chain chain = createChain();
+  if (readOutput(chain, false) != readOutput(chain, true)) {
+    std::printf("FAILED: the shared buffer path renders a different image\n");
+    destroyChain(chain);
+    return 1;
+  }
+
+  Result clientArrays = measure(chain, false);
+  Result sharedBuffer = measure(chain, true);
+  std::printf("%d filters at %dx%d, per frame:\n", kFilters, kSize, kSize);
+  std::printf(
+      "  client arrays, lookups by name: submit %.1f us, frame %.1f us\n",
+      clientArrays.submitMicros, clientArrays.frameMicros);
+  std::printf(
+      "  shared quad buffer, cached:     submit %.1f us, frame %.1f us\n",
+      sharedBuffer.submitMicros, sharedBuffer.frameMicros);
+
+  GLenum error = glGetError();
+  destroyChain(chain);
+  if (error != GL_NO_ERROR) {
+    std::printf("FAILED: GL error 0x%x\n", error);
+    return 1;
+  }
+  return 0;
+}
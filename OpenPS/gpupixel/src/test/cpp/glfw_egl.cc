@@ -0,0 +1,135 @@
+// The GLFW entry points GPUPixelContext uses on Linux, backed by an offscreen
+// EGL desktop GL context. Lets the host tests run the library on the Mesa
+// surfaceless platform without a window system. glfwInit() fails when there
+// is no EGL display, tests call it first to decide whether to skip.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstdlib>
+#include <cstring>
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+struct GLFWwindow {
+  EGLContext context = EGL_NO_CONTEXT;
+  EGLSurface surface = EGL_NO_SURFACE;
+};
+
+namespace {
+EGLDisplay display = EGL_NO_DISPLAY;
+EGLConfig config = nullptr;
+GLFWwindow* current = nullptr;
+}  // namespace
+
+extern "C" {
+
+int glfwInit(void) {
+  if (display != EGL_NO_DISPLAY) {
+    return GLFW_TRUE;
+  }
+  // Most of the library's shaders are GLSL ES without a #version line, which
+  // Mesa compiles as GLSL 1.10 on desktop GL and rejects precision qualifiers
+  // in. 1.30 accepts them and still has attribute, varying and gl_FragColor.
+  setenv("force_glsl_version", "130", 0);
+  const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+      "eglGetPlatformDisplayEXT");
+  EGLDisplay candidate = EGL_NO_DISPLAY;
+  if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") &&
+      getPlatformDisplay) {
+    candidate = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                   EGL_DEFAULT_DISPLAY, nullptr);
+  } else {
+    candidate = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  }
+  if (candidate == EGL_NO_DISPLAY || !eglInitialize(candidate, nullptr, nullptr)) {
+    return GLFW_FALSE;
+  }
+  const EGLint attributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                               EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+                               EGL_RED_SIZE, 8,
+                               EGL_GREEN_SIZE, 8,
+                               EGL_BLUE_SIZE, 8,
+                               EGL_ALPHA_SIZE, 8,
+                               EGL_NONE};
+  EGLint count = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(candidate, attributes, &config, 1, &count) ||
+      count == 0) {
+    eglTerminate(candidate);
+    return GLFW_FALSE;
+  }
+  display = candidate;
+  return GLFW_TRUE;
+}
+
+void glfwTerminate(void) {
+  if (display == EGL_NO_DISPLAY) {
+    return;
+  }
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglTerminate(display);
+  display = EGL_NO_DISPLAY;
+  current = nullptr;
+}
+
+void glfwWindowHint(int, int) {}
+
+GLFWwindow* glfwCreateWindow(int width, int height, const char*, GLFWmonitor*,
+                             GLFWwindow*) {
+  if (display == EGL_NO_DISPLAY) {
+    return nullptr;
+  }
+  // The library asks for a 3.2 compatibility profile
+  const EGLint contextAttributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 3,
+      EGL_CONTEXT_MINOR_VERSION, 2,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK,
+      EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+      EGL_NONE};
+  const EGLint surfaceAttributes[] = {EGL_WIDTH, width, EGL_HEIGHT, height,
+                                      EGL_NONE};
+  auto window = new GLFWwindow;
+  window->context =
+      eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+  window->surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+  if (window->context == EGL_NO_CONTEXT || window->surface == EGL_NO_SURFACE) {
+    glfwDestroyWindow(window);
+    return nullptr;
+  }
+  return window;
+}
+
+void glfwDestroyWindow(GLFWwindow* window) {
+  if (!window) {
+    return;
+  }
+  if (current == window) {
+    glfwMakeContextCurrent(nullptr);
+  }
+  if (window->surface != EGL_NO_SURFACE) {
+    eglDestroySurface(display, window->surface);
+  }
+  if (window->context != EGL_NO_CONTEXT) {
+    eglDestroyContext(display, window->context);
+  }
+  delete window;
+}
+
+void glfwMakeContextCurrent(GLFWwindow* window) {
+  if (display == EGL_NO_DISPLAY) {
+    return;
+  }
+  if (window) {
+    eglMakeCurrent(display, window->surface, window->surface, window->context);
+  } else {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  }
+  current = window;
+}
+
+GLFWwindow* glfwGetCurrentContext(void) {
+  return current;
+}
+
+}  // extern "C"
@@ -0,0 +1,81 @@
+// Offscreen GLES 2 context for the GL benchmarks. Uses the Mesa surfaceless
+// platform when it is available, so no window system is needed.
+
+#pragma once
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <cstdio>
+#include <cstring>
+
+// Exit code ctest reports as a skipped test
+constexpr int kSkipReturnCode = 77;
+
+class HeadlessGLContext {
+ public:
+  HeadlessGLContext() {
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress(
+        "eglGetPlatformDisplayEXT");
+    if (extensions && std::strstr(extensions, "EGL_MESA_platform_surfaceless") &&
+        getPlatformDisplay) {
+      _display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, nullptr);
+    } else {
+      _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    if (_display == EGL_NO_DISPLAY || !eglInitialize(_display, nullptr, nullptr)) {
+      _display = EGL_NO_DISPLAY;
+      return;
+    }
+
+    const EGLint configAttributes[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                       EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+                                       EGL_RED_SIZE, 8,
+                                       EGL_GREEN_SIZE, 8,
+                                       EGL_BLUE_SIZE, 8,
+                                       EGL_ALPHA_SIZE, 8,
+                                       EGL_NONE};
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(_display, configAttributes, &config, 1, &count) ||
+        count == 0) {
+      return;
+    }
+    const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    _context = eglCreateContext(_display, config, EGL_NO_CONTEXT,
+                                contextAttributes);
+    const EGLint surfaceAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    _surface = eglCreatePbufferSurface(_display, config, surfaceAttributes);
+    if (_context == EGL_NO_CONTEXT || _surface == EGL_NO_SURFACE) {
+      return;
+    }
+    _current = eglMakeCurrent(_display, _surface, _surface, _context);
+    if (_current) {
+      std::printf("GL renderer: %s\n", glGetString(GL_RENDERER));
+    }
+  }
+
+  ~HeadlessGLContext() {
+    if (_display == EGL_NO_DISPLAY) {
+      return;
+    }
+    eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (_surface != EGL_NO_SURFACE) {
+      eglDestroySurface(_display, _surface);
+    }
+    if (_context != EGL_NO_CONTEXT) {
+      eglDestroyContext(_display, _context);
+    }
+    eglTerminate(_display);
+  }
+
+  bool isCurrent() const { return _current; }
+
+ private:
+  EGLDisplay _display = EGL_NO_DISPLAY;
+  EGLContext _context = EGL_NO_CONTEXT;
+  EGLSurface _surface = EGL_NO_SURFACE;
+  bool _current = false;
+};
@@ -0,0 +1,233 @@
+// Replays a landmark sequence through LandmarkTracker and LandmarkSmoother
+// the way FaceDetector::ProcessVideoFrame() does, and reports tracking error,
+// jitter and CPU time. The sequence is generated from a fixed seed: a
+// textured face region moves along a known path, and every detection is the
+// true position plus the per-point noise of the face model.
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+#include "landmark_tracker.h"
+
+using namespace gpupixel;
+
+namespace {
+constexpr int kWidth = 360;
+constexpr int kHeight = 640;
+constexpr int kPoints = 111;
+constexpr float kDetectionNoise = 1.0f;
+constexpr float kFrameTime = 1.0f / 30;
+constexpr int kDetectionInterval = 5;
+
+int failures = 0;
+
+#define EXPECT_LT(value, bound)                                          \
+  do {                                                                   \
+    if (!((value) < (bound))) {                                          \
+      std::printf("FAILED %s:%d: %s = %f, expected < %f\n", __FILE__,     \
+                  __LINE__, #value, (double) (value), (double) (bound)); \
+      ++failures;                                                        \
+    }                                                                    \
+  } while (0)
+
+struct Pose {
+  float x;
+  float y;
+};
+
+// Smooth texture that can be sampled at any sub-pixel offset
+class Scene {
+ public:
+  Scene() {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> freq(0.15f, 0.8f);
+    std::uniform_real_distribution<float> phase(0.0f, 6.2832f);
+    for (auto& wave : _waves) {
+      wave = {freq(rng), freq(rng) - 0.45f, phase(rng)};
+    }
+  }
+
+  void render(const Pose& pose, std::vector<uint8_t>& gray) const {
+    gray.resize(kWidth * kHeight);
+    for (int y = 0; y < kHeight; ++y) {
+      for (int x = 0; x < kWidth; ++x) {
+        float u = x - pose.x;
+        float v = y - pose.y;
+        float value = 128.0f;
+        for (const auto& wave : _waves) {
+          value += 14.0f * std::sin(wave.fx * u + wave.fy * v + wave.phase);
+        }
+        gray[y * kWidth + x] = (uint8_t) std::min(255.0f, std::max(0.0f, value));
+      }
+    }
+  }
+
+ private:
+  struct Wave {
+    float fx;
+    float fy;
+    float phase;
+  };
+  Wave _waves[8];
+};
+
+std::vector<float> truthLandmarks(const Pose& pose) {
+  std::vector<float> landmarks;
+  for (int i = 0; i < kPoints; ++i) {
+    // spread over a face sized region around the frame center
+    float x = 120.0f + (i % 11) * 12.0f + pose.x;
+    float y = 220.0f + (i / 11) * 20.0f + pose.y;
+    landmarks.push_back(x / kWidth);
+    landmarks.push_back(y / kHeight);
+  }
+  return landmarks;
+}
+
+// Mean distance in pixels between two landmark vectors
+float meanError(const std::vector<float>& a, const std::vector<float>& b) {
+  float sum = 0.0f;
+  for (int i = 0; i < kPoints; ++i) {
+    float dx = (a[i * 2] - b[i * 2]) * kWidth;
+    float dy = (a[i * 2 + 1] - b[i * 2 + 1]) * kHeight;
+    sum += std::sqrt(dx * dx + dy * dy);
+  }
+  return sum / kPoints;
+}
+
+struct Sequence {
+  std::vector<Pose> poses;
+  std::vector<std::vector<uint8_t>> frames;
+};
+
+// Holds still, drifts slowly, then swipes across the frame
+Sequence generatedSequence() {
+  Sequence sequence;
+  Pose pose = {0.0f, 0.0f};
+  for (int frame = 0; frame < 180; ++frame) {
+    if (frame >= 60 && frame < 120) {
+      pose.x += 0.4f;
+      pose.y += 0.2f;
+    } else if (frame >= 120) {
+      pose.x -= 1.2f;
+      pose.y -= 0.6f;
+    }
+    sequence.poses.push_back(pose);
+  }
+  Scene scene;
+  sequence.frames.resize(sequence.poses.size());
+  for (size_t frame = 0; frame < sequence.poses.size(); ++frame) {
+    scene.render(sequence.poses[frame], sequence.frames[frame]);
+  }
+  return sequence;
+}
+
+struct Result {
+  float meanError = 0.0f;
+  float jitter = 0.0f;
+  double trackMillis = 0.0;
+};
+
+// detectionInterval 1 runs the model on every frame, like before tracking
+Result replay(const Sequence& sequence, int detectionInterval, bool smooth,
+              int firstFrame, int lastFrame) {
+  LandmarkTracker tracker;
+  LandmarkSmoother smoother;
+  std::mt19937 rng(11);
+  std::normal_distribution<float> noise(0.0f, kDetectionNoise);
+
+  std::vector<float> previous;
+  int framesSinceDetection = 0;
+  int trackedFrames = 0;
+  Result result;
+  int measured = 0;
+  for (int frame = 0; frame <= lastFrame; ++frame) {
+    const Pose& pose = sequence.poses[frame];
+    const std::vector<uint8_t>& gray = sequence.frames[frame];
+    std::vector<float> truth = truthLandmarks(pose);
+    std::vector<float> landmarks;
+
+    bool detect = detectionInterval <= 1 || !tracker.isTracking() ||
+                  framesSinceDetection >= detectionInterval;
+    if (!detect) {
+      auto start = std::chrono::steady_clock::now();
+      float confidence = tracker.track(gray.data(), kWidth, kHeight, landmarks);
+      result.trackMillis += std::chrono::duration<double, std::milli>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+      ++trackedFrames;
+      if (confidence >= 0.8f) {
+        ++framesSinceDetection;
+      } else {
+        detect = true;
+      }
+    }
+    if (detect) {
+      landmarks = truth;
+      for (size_t i = 0; i < landmarks.size(); i += 2) {
+        landmarks[i] += noise(rng) / kWidth;
+        landmarks[i + 1] += noise(rng) / kHeight;
+      }
+      tracker.reset(gray.data(), kWidth, kHeight, landmarks);
+      framesSinceDetection = 1;
+    }
+    if (smooth) {
+      smoother.filter(landmarks, kFrameTime);
+    }
+
+    if (frame >= firstFrame) {
+      result.meanError += meanError(landmarks, truth);
+      if (!previous.empty()) {
+        // frame to frame motion that the true motion doesn't explain
+        std::vector<float> previousTruth = truthLandmarks(sequence.poses[frame - 1]);
+        for (size_t i = 0; i < previous.size(); ++i) {
+          previous[i] += truth[i] - previousTruth[i];
+        }
+        result.jitter += meanError(landmarks, previous);
+      }
+      ++measured;
+    }
+    previous = landmarks;
+  }
+  result.meanError /= measured;
+  result.jitter /= measured - 1;
+  if (trackedFrames > 0) {
+    result.trackMillis /= trackedFrames;
+  }
+  return result;
+}
+
+void report(const char* name, const Result& result) {
+  std::printf("%-28s error %.2f px  jitter %.2f px  track %.3f ms/frame\n",
+              name, result.meanError, result.jitter, result.trackMillis);
+}
+}  // namespace
+
+int main() {
+  Sequence sequence = generatedSequence();
+
+  // Still face: the raw model output jitters, the filtered output must not
+  Result rawStill = replay(sequence, 1, false, 10, 59);
+  Result smoothStill = replay(sequence, 1, true, 10, 59);
+  Result trackedStill = replay(sequence, kDetectionInterval, true, 10, 59);
+  report("still, detect every frame", rawStill);
+  report("still, smoothed", smoothStill);
+  report("still, tracked + smoothed", trackedStill);
+  EXPECT_LT(smoothStill.jitter, rawStill.jitter * 0.5f);
+  EXPECT_LT(trackedStill.jitter, rawStill.jitter * 0.5f);
+
+  // Slow drift and a fast swipe: tracking follows, smoothing adds little lag
+  Result rawMoving = replay(sequence, 1, false, 60, 179);
+  Result trackedMoving = replay(sequence, kDetectionInterval, true, 60, 179);
+  report("moving, detect every frame", rawMoving);
+  report("moving, tracked + smoothed", trackedMoving);
+  EXPECT_LT(trackedMoving.meanError, 2.5f);
+  EXPECT_LT(trackedMoving.jitter, rawMoving.jitter);
+
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
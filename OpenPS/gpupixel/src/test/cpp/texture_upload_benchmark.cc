@@ -0,0 +1,186 @@
+// Upload throughput of SourceRawDataInput frames at 1080p and 4K, RGBA and
+// I420. Replays the texture uploads twice: respecifying every texture with
+// glTexImage2D on each frame, as before, and allocating once and then
+// overwriting with glTexSubImage2D, as SourceRawDataInput::uploadTexture()
+// does now. Each frame is finished before the next one starts, and the in
+// place path has to keep up with 30 fps video.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+#include "headless_gl_context.h"
+
+namespace {
+constexpr int kWarmupFrames = 5;
+constexpr int kRounds = 3;
+constexpr double kMinFps = 30.0;
+
+struct Plane {
+  GLenum format;
+  int width;
+  int height;
+  int bytesPerPixel;
+};
+
+struct Layout {
+  const char* name;
+  std::vector<Plane> planes;
+};
+
+Layout rgbaLayout(int width, int height) {
+  return {"RGBA", {{GL_RGBA, width, height, 4}}};
+}
+
+Layout i420Layout(int width, int height) {
+  return {"I420",
+          {{GL_LUMINANCE, width, height, 1},
+           {GL_LUMINANCE, width / 2, height / 2, 1},
+           {GL_LUMINANCE, width / 2, height / 2, 1}}};
+}
+
+class Uploader {
+ public:
+  Uploader(const Layout& layout, bool inPlace)
+      : _layout(layout), _inPlace(inPlace) {
+    _textures.resize(layout.planes.size());
+    glGenTextures((GLsizei)_textures.size(), _textures.data());
+    for (GLuint texture : _textures) {
+      glBindTexture(GL_TEXTURE_2D, texture);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    _sizes.assign(_textures.size(), {0, 0});
+  }
+
+  ~Uploader() { glDeleteTextures((GLsizei)_textures.size(), _textures.data()); }
+
+  void upload(const std::vector<const uint8_t*>& pixels) {
+    for (size_t i = 0; i < _textures.size(); ++i) {
+      const Plane& plane = _layout.planes[i];
+      glActiveTexture(GL_TEXTURE0 + (GLenum)i);
+      glBindTexture(GL_TEXTURE_2D, _textures[i]);
+      glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+      if (!_inPlace || _sizes[i].first != plane.width ||
+          _sizes[i].second != plane.height) {
+        glTexImage2D(GL_TEXTURE_2D, 0, plane.format, plane.width, plane.height,
+                     0, plane.format, GL_UNSIGNED_BYTE, pixels[i]);
+        _sizes[i] = {plane.width, plane.height};
+      } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height,
+                        plane.format, GL_UNSIGNED_BYTE, pixels[i]);
+      }
+    }
+  }
+
+ private:
+  const Layout& _layout;
+  bool _inPlace;
+  std::vector<GLuint> _textures;
+  std::vector<std::pair<int, int>> _sizes;
+};
+
+// Two different frames, so consecutive uploads never repeat their contents
+struct Frames {
+  std::vector<std::vector<uint8_t>> planes[2];
+  size_t bytes = 0;
+
+  explicit Frames(const Layout& layout) {
+    for (int frame = 0; frame < 2; ++frame) {
+      for (const Plane& plane : layout.planes) {
+        std::vector<uint8_t> data(
+            (size_t)plane.width * plane.height * plane.bytesPerPixel);
+        for (size_t i = 0; i < data.size(); ++i) {
+          data[i] = (uint8_t)((i * 7 + frame * 101) % 253);
+        }
+        planes[frame].push_back(std::move(data));
+      }
+    }
+    for (const auto& data : planes[0]) {
+      bytes += data.size();
+    }
+  }
+
+  std::vector<const uint8_t*> pointers(int frame) const {
+    std::vector<const uint8_t*> result;
+    for (const auto& data : planes[frame % 2]) {
+      result.push_back(data.data());
+    }
+    return result;
+  }
+};
+
+// Milliseconds per frame, the lowest of kRounds runs
+double measure(const Layout& layout, const Frames& frames, int frameCount,
+               bool inPlace) {
+  Uploader uploader(layout, inPlace);
+  for (int i = 0; i < kWarmupFrames; ++i) {
+    uploader.upload(frames.pointers(i));
+    glFinish();
+  }
+  double best = 1e30;
+  for (int round = 0; round < kRounds; ++round) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frameCount; ++i) {
+      uploader.upload(frames.pointers(i));
+      glFinish();
+    }
+    double millis = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    best = std::min(best, millis / frameCount);
+  }
+  return best;
+}
+
+void report(const char* size, const Layout& layout, const Frames& frames,
+            const char* mode, double millis) {
+  std::printf("  %-5s %s %-20s %6.2f ms/frame  %6.1f fps  %7.1f MB/s\n", size,
+              layout.name, mode, millis, 1000.0 / millis,
+              frames.bytes / (millis * 1000.0));
+}
+}  // namespace
+
+int main() {
+  HeadlessGLContext context;
+  if (!context.isCurrent()) {
+    std::printf("no EGL display, skipped\n");
+    return kSkipReturnCode;
+  }
+
+  struct Size {
+    const char* name;
+    int width;
+    int height;
+    int frames;
+  };
+  const Size sizes[] = {{"1080p", 1920, 1080, 60}, {"4K", 3840, 2160, 20}};
+  int failures = 0;
+  for (const Size& size : sizes) {
+    const Layout layouts[] = {rgbaLayout(size.width, size.height),
+                              i420Layout(size.width, size.height)};
+    for (const Layout& layout : layouts) {
+      Frames frames(layout);
+      double respecify = measure(layout, frames, size.frames, false);
+      double inPlace = measure(layout, frames, size.frames, true);
+      report(size.name, layout, frames, "glTexImage2D", respecify);
+      report(size.name, layout, frames, "glTexSubImage2D", inPlace);
+      if (inPlace > 1000.0 / kMinFps) {
+        std::printf("FAILED: %s %s uploads below %.0f fps\n", size.name,
+                    layout.name, kMinFps);
+        ++failures;
+      }
+    }
+  }
+
+  GLenum error = glGetError();
+  if (error != GL_NO_ERROR) {
+    std::printf("FAILED: GL error 0x%x\n", error);
+    return 1;
+  }
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,147 @@
+// A full resolution export split into two tiles has to match the same export
+// rendered in one pass. The preview runs on an eighth size proxy, so the
+// blur spacing the tile overlap is sized from has to be the full resolution
+// one, not the proxy's, or the tiles show seams where they meet.
+
+#include <unistd.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "openps_helper.h"
+#include "png_stream_writer.h"
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
+
+namespace {
+constexpr int kSkipReturnCode = 77;
+constexpr int kWidth = 600;
+constexpr int kHeight = 240;
+// Two tiles side by side, wide enough that the overlap is not clamped
+constexpr int kTileSize = 512;
+constexpr int kTolerance = 1;
+
+// The resources of the library plus a skin mask that covers the whole image
+std::string createResourceDir() {
+  char pattern[] = "/tmp/tiled_export_test_XXXXXX";
+  if (!mkdtemp(pattern)) {
+    return "";
+  }
+  std::string dir = pattern;
+  for (const char* name : {"lookup_gray.png", "lookup_origin.png",
+                           "lookup_skin.png", "lookup_light.png"}) {
+    std::string target = std::string(GPUPIXEL_RESOURCE_DIR) + "/" + name;
+    if (symlink(target.c_str(), (dir + "/" + name).c_str()) != 0) {
+      return "";
+    }
+  }
+  gpupixel::PngStreamWriter writer;
+  std::vector<uint8_t> white((size_t)kWidth * kHeight * 4, 255);
+  if (!writer.open(dir + "/skin_mask.png", kWidth, kHeight) ||
+      !writer.writeRows(white.data(), kHeight) || !writer.close()) {
+    return "";
+  }
+  return dir;
+}
+
+void removeResourceDir(const std::string& dir) {
+  for (const char* name : {"lookup_gray.png", "lookup_origin.png",
+                           "lookup_skin.png", "lookup_light.png",
+                           "skin_mask.png"}) {
+    unlink((dir + "/" + name).c_str());
+  }
+  rmdir(dir.c_str());
+}
+
+// Skin tones with fine noise, which the smoothing blurs, over a gradient
+std::vector<uint8_t> createImage() {
+  const int skin[3] = {200, 150, 120};
+  std::vector<uint8_t> pixels((size_t)kWidth * kHeight * 4);
+  uint32_t state = 12345;
+  for (int y = 0; y < kHeight; ++y) {
+    for (int x = 0; x < kWidth; ++x) {
+      uint8_t* pixel = pixels.data() + ((size_t)y * kWidth + x) * 4;
+      for (int c = 0; c < 3; ++c) {
+        state = state * 1664525u + 1013904223u;
+        int noise = (int)(state >> 27) - 16;
+        pixel[c] = (uint8_t)(skin[c] + (x + y) % 40 - 20 + noise);
+      }
+      pixel[3] = 255;
+    }
+  }
+  return pixels;
+}
+
+std::vector<uint8_t> exportImage(gpupixel::OpenPSHelper& helper, int tileSize) {
+  std::vector<uint8_t> result;
+  helper.setMaxTileSize(tileSize);
+  helper.setRawOutputCallback(
+      [&result](const uint8_t* data, int width, int height, int64_t) {
+        result.assign(data, data + (size_t)width * height * 4);
+      });
+  helper.requestRender(true);
+  return result;
+}
+}  // namespace
+
+int main() {
+  if (!glfwInit()) {
+    std::printf("no EGL display, skipped\n");
+    return kSkipReturnCode;
+  }
+  std::string resourceDir = createResourceDir();
+  if (resourceDir.empty()) {
+    std::printf("FAILED: could not create the resource directory\n");
+    return 1;
+  }
+  gpupixel::Util::setResourceRoot(resourceDir);
+
+  std::vector<uint8_t> image = createImage();
+  std::vector<uint8_t> single;
+  std::vector<uint8_t> tiled;
+  {
+    // The helper is made on the thread that renders, as the app's GL thread
+    gpupixel::GPUPixelContext::getInstance()->useAsCurrent();
+    gpupixel::OpenPSHelper helper;
+    helper.initWithImage(kWidth, kHeight, 4, image.data());
+    helper.onTargetViewSizeChanged(kWidth / 8, kHeight / 8);
+    helper.buildRealRenderPipeline();
+    helper.setSmoothLevel(1);
+    helper.requestRender(true);
+
+    single = exportImage(helper, kWidth);
+    tiled = exportImage(helper, kTileSize);
+  }
+  removeResourceDir(resourceDir);
+
+  size_t expected = (size_t)kWidth * kHeight * 4;
+  if (single.size() != expected || tiled.size() != expected) {
+    std::printf("FAILED: export returned %zu and %zu bytes, expected %zu\n",
+                single.size(), tiled.size(), expected);
+    return 1;
+  }
+  if (single == image) {
+    std::printf("FAILED: the smoothing left the image unchanged\n");
+    return 1;
+  }
+  int maxDiff = 0;
+  int diffColumn = 0;
+  for (size_t i = 0; i < expected; ++i) {
+    int diff = std::abs((int)single[i] - (int)tiled[i]);
+    if (diff > maxDiff) {
+      maxDiff = diff;
+      diffColumn = (int)(i / 4 % kWidth);
+    }
+  }
+  std::printf("%dx%d in %d px tiles: max difference %d at column %d\n",
+              kWidth, kHeight, kTileSize, maxDiff, diffColumn);
+  if (maxDiff > kTolerance) {
+    std::printf("FAILED: tiled export differs from the single pass by more "
+                "than %d\n", kTolerance);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,41 @@
+// Stands in for the vnn face model, whose Linux libraries are incomplete in
+// this tree. Detection always finds no face, tests that need landmarks set
+// them on the filters directly.
+
+#include <cstring>
+#include "vnn_face.h"
+#include "vnn_kit.h"
+
+extern "C" {
+
+VNN_Result VNN_SetLogLevel(VNNUInt32) {
+  return VNN_Result_Success;
+}
+
+VNN_Result VNN_Create_Face(VNNHandle* handle, const int, const void*[]) {
+  *handle = 0;
+  return VNN_Result_Success;
+}
+
+VNN_Result VNN_Destroy_Face(VNNHandle* handle) {
+  *handle = 0;
+  return VNN_Result_Success;
+}
+
+VNN_Result VNN_Apply_Face_CPU(VNNHandle, const void*, void* output) {
+  static_cast<VNN_FaceFrameDataArr*>(output)->facesNum = 0;
+  return VNN_Result_Success;
+}
+
+VNN_Result VNN_Set_Face_Attr(VNNHandle, const char*, const void*) {
+  return VNN_Result_Success;
+}
+
+VNN_Result VNN_Get_Face_Attr(VNNHandle, const char* name, void* value) {
+  if (std::strcmp(name, "_detection_data") == 0) {
+    static_cast<VNN_FaceFrameDataArr*>(value)->facesNum = 0;
+  }
+  return VNN_Result_Success;
+}
+
+}  // extern "C"
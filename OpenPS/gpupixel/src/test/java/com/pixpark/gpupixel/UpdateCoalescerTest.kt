@@ -0,0 +1,100 @@
+package com.pixpark.gpupixel
+
+import org.junit.Assert.assertEquals
+import org.junit.Assert.assertNull
+import org.junit.Before
+import org.junit.Test
+
+/**
+ * Replays parameter changes through [UpdateCoalescer] against a manually
+ * stepped frame clock and counts the renders they cause. A plain JVM test,
+ * run it with `./gradlew :gpupixel:testDebugUnitTest`.
+ */
+class UpdateCoalescerTest {
+    private class ManualFrameScheduler : UpdateCoalescer.FrameScheduler {
+        var pending: (() -> Unit)? = null
+
+        override fun postFrame(callback: () -> Unit) {
+            pending = callback
+        }
+
+        override fun cancelFrame() {
+            pending = null
+        }
+
+        fun frame() {
+            val callback = pending
+            pending = null
+            callback?.invoke()
+        }
+    }
+
+    private lateinit var scheduler: ManualFrameScheduler
+    private lateinit var coalescer: UpdateCoalescer
+    private var renderCount = 0
+    private val applied = mutableListOf<String>()
+
+    @Before
+    fun setUp() {
+        scheduler = ManualFrameScheduler()
+        renderCount = 0
+        applied.clear()
+        coalescer = UpdateCoalescer(scheduler) { updates ->
+            updates.forEach { it() }
+            renderCount++
+        }
+    }
+
+    @Test
+    fun sliderDrag_rendersOncePerFrame() {
+        val changesPerFrame = 10
+        var level = 0f
+        for (i in 0 until 200) {
+            val value = i / 199f
+            coalescer.post("smooth", false) { level = value }
+            if ((i + 1) % changesPerFrame == 0) {
+                scheduler.frame()
+            }
+        }
+
+        assertEquals(200 / changesPerFrame, renderCount)
+        assertEquals(1f, level, 0f)
+    }
+
+    @Test
+    fun differentKeys_shareOneRender() {
+        for (i in 0 until 200) {
+            val key = if (i % 2 == 0) "contrast" else "exposure"
+            coalescer.post(key, false) { applied.add("$key$i") }
+        }
+        scheduler.frame()
+
+        assertEquals(1, renderCount)
+        assertEquals(listOf("contrast198", "exposure199"), applied)
+    }
+
+    @Test
+    fun recordedUpdates_areAllKeptInOrder() {
+        coalescer.post("white", false) { applied.add("drag") }
+        coalescer.post("white", true) { applied.add("release") }
+        coalescer.post("white", false) { applied.add("drag again") }
+        coalescer.post("white", true) { applied.add("release again") }
+        scheduler.frame()
+
+        assertEquals(1, renderCount)
+        assertEquals(listOf("release", "drag again", "release again"), applied)
+    }
+
+    @Test
+    fun flush_dispatchesImmediatelyAndCancelsFrame() {
+        coalescer.post("sharpen", false) { applied.add("sharpen") }
+        coalescer.flush()
+
+        assertEquals(1, renderCount)
+        assertNull(scheduler.pending)
+
+        scheduler.frame()
+        coalescer.flush()
+        assertEquals(1, renderCount)
+    }
+}